@@ -23,6 +23,7 @@ class CLParser {
     bool Flag(const std::string&);
     std::string Option(const std::string&, const std::string);
     std::vector<std::string> MultiOption(const std::string&, int, int);
+    std::vector<std::string> RepeatedOption(const std::string&);
 };
 
 CLParser::CLParser(int &argc, char** argv) {
@@ -43,8 +44,7 @@ std::string CLParser::Option(const std::string &flag, const std::string default_
     if (found != tokens.end() && ++found != tokens.end()) {
         return *found;
     }
-    static const std::string empty(default_value);
-    return empty;
+    return default_value;
 }
 
 // parse options (multiple parameters for this option)
@@ -66,4 +66,16 @@ std::vector<std::string> CLParser::MultiOption(const std::string &flag, int dept
     return opts;
 }
 
+// parse options that can be given more than once (returns the
+// argument of every occurrence)
+std::vector<std::string> CLParser::RepeatedOption(const std::string &flag) {
+    std::vector<std::string> values;
+    for (auto it = tokens.begin(); it != tokens.end(); it++) {
+        if (*it == flag && it + 1 != tokens.end()) {
+            values.push_back(*(it + 1));
+        }
+    }
+    return values;
+}
+
 #endif  // INTERFACE_CLPARSER_H_
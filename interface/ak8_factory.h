@@ -5,60 +5,69 @@
 
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
-#include "TLorentzVector.h"
+#include "./branch_registry.h"
+#include "./collection.h"
+#include "./p4.h"
 #include "TTree.h"
 
-class AK8;  // AK8 combines all tau information
-typedef std::vector<AK8> VAK8;
+class AK8;  // AK8 combines all ak8 jet information
+typedef Collection<AK8> VAK8;
 
-// AK8 combines all tau related information along with
-// creating the ak8 jet 4-vector. Helper functions are provided
-// to access properties of the ak8 jets. These properties cannot
-// be updated.
+// AK8 gives access to all ak8 jet related information along with
+// creating the ak8 jet 4-vector. The information is stored in the
+// Columns of a VAK8 and the AK8 only points to its row, so it is
+// cheap to copy. Helper functions are provided to access
+// properties of the ak8 jets. These properties cannot be updated.
 class AK8 {
-    friend class AK8_Factory;  // AK8_Factory constructs individual AK8s
-
    public:
-    AK8(Float_t _pt, Float_t _eta, Float_t _phi, Float_t _en) { this->p4.SetPtEtaPhiE(_pt, _eta, _phi, _en); }
-    AK8() { this->p4.SetPtEtaPhiE(0, 0, 0, 0); }
+    // Columns holds every ak8 jet variable for all ak8 jets in the event.
+    struct Columns {
+        std::vector<Float_t> pt, eta, phi, mass, AK8JetPrunedMass, AK8JetSoftDropMass;
+        std::vector<Int_t> jetPartonID, jetHadFlvr;
+        std::vector<Bool_t> jetPFLooseId;
+        void clear();
+    };
+
+    AK8() : columns(nullptr), row(0) {}
+    AK8(const Columns *_columns, unsigned _row) : columns(_columns), row(_row) {}
 
     // getters
-    TLorentzVector getP4() { return p4; }
-    Float_t getPt() { return p4.Pt(); }
-    Float_t getEta() { return p4.Eta(); }
-    Float_t getPhi() { return p4.Phi(); }
-    Float_t getMass() { return p4.M(); }
-    Bool_t getJetPFLooseId() { return jetPFLooseId; }
-    Int_t getPartonID() { return jetPartonID; }
-    Int_t getHadFlvr() { return jetHadFlvr; }
-    Float_t getPrunedMass() { return AK8JetPrunedMass; }
-    Float_t getSoftDropMass() { return AK8JetSoftDropMass; }
+    PtEtaPhiM getP4() const { return PtEtaPhiM(getPt(), getEta(), getPhi(), getMass()); }
+    Float_t getPt() const { return columns->pt[row]; }
+    Float_t getEta() const { return columns->eta[row]; }
+    Float_t getPhi() const { return columns->phi[row]; }
+    Float_t getMass() const { return columns->mass[row]; }
+    Bool_t getJetPFLooseId() const { return columns->jetPFLooseId[row]; }
+    Int_t getPartonID() const { return columns->jetPartonID[row]; }
+    Int_t getHadFlvr() const { return columns->jetHadFlvr[row]; }
+    Float_t getPrunedMass() const { return columns->AK8JetPrunedMass[row]; }
+    Float_t getSoftDropMass() const { return columns->AK8JetSoftDropMass[row]; }
 
    private:
-    // these should never be modified once read from the TTree
-    TLorentzVector p4;
-    Bool_t jetPFLooseId;
-    Int_t jetPartonID, jetHadFlvr;
-    ULong64_t jetFiredTrgs;
-    Float_t AK8JetPrunedMass, AK8JetSoftDropMass;
+    const Columns *columns;
+    unsigned row;
 };
 
 // AK8_Factory reads from the TTree and constructs
 // individual AK8 objects. The AK8_Factory holds the
-// list of ak8 jets, but can provided a shared_ptr to the
-// list.
+// list of ak8 jets. The list is handed out by
+// reference and is only valid until the next Run_Factory.
 class AK8_Factory {
    public:
     AK8_Factory(TTree *, bool);
     void Run_Factory();
+    Int_t Load(Long64_t entry) { return registry.Load(entry); }  // read only this factory's branches
 
     // getters
+    const std::vector<std::string> &getBranches() { return registry.getNames(); }  // branches read by this factory
     Int_t getNTotalAK8() { return nJet; }     // nJet directly from TTree
     Int_t getNGoodAK8() { return nGoodJet; }  // nJet passing preselection
-    std::shared_ptr<VAK8> getAK8() { return std::make_shared<VAK8>(jets); }
+    const VAK8 &getAK8() const { return jets; }
 
    private:
+    Branch_Registry registry;
     Bool_t is_data;
     Int_t nJet, nGoodJet;
     VAK8 jets;
@@ -69,7 +78,8 @@ class AK8_Factory {
 
 // Set all branch addresses when constructing a AK8_Factory.
 AK8_Factory::AK8_Factory(TTree *tree, bool is_data_)
-    : is_data(is_data_),
+    : registry(tree),
+      is_data(is_data_),
       jetPt(nullptr),
       jetEta(nullptr),
       jetPhi(nullptr),
@@ -79,43 +89,53 @@ AK8_Factory::AK8_Factory(TTree *tree, bool is_data_)
       jetPFLooseId(nullptr),
       AK8JetPrunedMass(nullptr),
       AK8JetSoftDropMass(nullptr) {
-    tree->SetBranchAddress("nAK8Jet", &nJet);
-    tree->SetBranchAddress("AK8JetPt", &jetPt);
-    tree->SetBranchAddress("AK8JetEn", &jetEn);
-    tree->SetBranchAddress("AK8JetEta", &jetEta);
-    tree->SetBranchAddress("AK8JetPhi", &jetPhi);
-    tree->SetBranchAddress("AK8JetPFLooseId", &jetPFLooseId);
-    tree->SetBranchAddress("AK8JetPrunedMass", &AK8JetPrunedMass);
-    tree->SetBranchAddress("AK8JetSoftDropMass", &AK8JetSoftDropMass);
+    registry.Bind("nAK8Jet", &nJet);
+    registry.Bind("AK8JetPt", &jetPt);
+    registry.Bind("AK8JetEn", &jetEn);
+    registry.Bind("AK8JetEta", &jetEta);
+    registry.Bind("AK8JetPhi", &jetPhi);
+    registry.Bind("AK8JetPFLooseId", &jetPFLooseId);
+    registry.Bind("AK8JetPrunedMass", &AK8JetPrunedMass);
+    registry.Bind("AK8JetSoftDropMass", &AK8JetSoftDropMass);
     if (!is_data) {  // not available in data
-        tree->SetBranchAddress("AK8JetPartonID", &jetPartonID);
-        tree->SetBranchAddress("AK8JetHadFlvr", &jetHadFlvr);
+        registry.Bind("AK8JetPartonID", &jetPartonID);
+        registry.Bind("AK8JetHadFlvr", &jetHadFlvr);
     }
 }
 
-// Called once per event to construct the AK8s. A basic
-// preselection is applied to all ak8 jets. All AK8s passing
-// preselection are sorted by pT and stored.
+// Called once per event to fill the ak8 jet columns. A basic
+// preselection is applied to all ak8 jets. All ak8 jets passing
+// preselection are stored and ordered by pT.
 void AK8_Factory::Run_Factory() {
-    jets.clear();
+    auto &columns = jets.Reset();
     for (auto i = 0; i < nJet; i++) {
         if (jetPt->at(i) < 30 || fabs(jetEta->at(i)) > 3) {  // baseline cuts
             continue;
         }
-        auto jet = AK8(jetPt->at(i), jetEta->at(i), jetPhi->at(i), jetEn->at(i));
-        jet.jetPFLooseId = jetPFLooseId->at(i);
-        jet.AK8JetPrunedMass = AK8JetPrunedMass->at(i);
-        jet.AK8JetSoftDropMass = AK8JetSoftDropMass->at(i);
-        if (!is_data) {  // not available in data
-            jet.jetPartonID = jetPartonID->at(i);
-            jet.jetHadFlvr = jetHadFlvr->at(i);
-        }
-        jets.push_back(jet);
+        columns.pt.push_back(jetPt->at(i));
+        columns.eta.push_back(jetEta->at(i));
+        columns.phi.push_back(jetPhi->at(i));
+        columns.mass.push_back(PtEtaPhiM::FromPtEtaPhiE(jetPt->at(i), jetEta->at(i), jetPhi->at(i), jetEn->at(i)).M());
+        columns.jetPFLooseId.push_back(jetPFLooseId->at(i));
+        columns.AK8JetPrunedMass.push_back(AK8JetPrunedMass->at(i));
+        columns.AK8JetSoftDropMass.push_back(AK8JetSoftDropMass->at(i));
+        columns.jetPartonID.push_back(is_data ? 0 : jetPartonID->at(i));  // not available in data
+        columns.jetHadFlvr.push_back(is_data ? 0 : jetHadFlvr->at(i));
     }
 
     // sort by pT
-    std::sort(jets.begin(), jets.end(), [](AK8 &p1, AK8 &p2) -> bool { return p1.getPt() > p2.getPt(); });
+    jets.Sort();
     nGoodJet = jets.size();
 }
 
+// clear empties all columns while keeping their memory.
+void AK8::Columns::clear() {
+    for (auto column : {&pt, &eta, &phi, &mass, &AK8JetPrunedMass, &AK8JetSoftDropMass}) {
+        column->clear();
+    }
+    jetPartonID.clear();
+    jetHadFlvr.clear();
+    jetPFLooseId.clear();
+}
+
 #endif  // INTERFACE_AK8_FACTORY_H_
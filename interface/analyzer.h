@@ -0,0 +1,114 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_ANALYZER_H_
+#define INTERFACE_ANALYZER_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./event_view.h"
+#include "./hist_buffer.h"
+#include "./histManager.h"
+
+// Analyzer is a selection run by the analyzer host. Several analyzers
+// can run over the same input and share one Event_View, so the input
+// is only read once. Every analyzer has its own histManager and output
+// file. The host calls the hooks in this order:
+//   - Begin once per instance, before any event. Histogram handles are
+//     looked up here, so a missing histogram stops the job right away.
+//   - Process for every event, with the buffer of the current range.
+//   - End once, on a single instance, after the buffers of all threads
+//     have been merged and before the histograms are written.
+// The host creates one instance per thread, so an analyzer can keep
+// state between events without any locking.
+class Analyzer {
+   public:
+    virtual ~Analyzer() {}
+    virtual void Begin(const histManager &) {}
+    virtual void Process(Event_View *, Hist_Buffer *) = 0;
+    virtual void End(histManager *) {}
+};
+
+// Analyzer_Registry maps the name of every analyzer to a function
+// creating a new instance. Analyzers are added with REGISTER_ANALYZER
+// and created by name with Make. An analyzer can also register the
+// json config of its histograms, which is used instead of the host's
+// default config.
+class Analyzer_Registry {
+   public:
+    typedef std::function<Analyzer *()> Maker;
+    bool Add(const std::string &, Maker, const std::string &histograms = "");
+    std::unique_ptr<Analyzer> Make(const std::string &) const;
+
+    // getters
+    std::vector<std::string> getNames() const;
+    std::string getHistograms(const std::string &, const std::string &) const;
+
+   private:
+    std::map<std::string, Maker> makers;
+    std::map<std::string, std::string> histograms;  // only for analyzers with their own config
+};
+
+// analyzer_registry returns the registry shared by all analyzers. It
+// is created on first use, so analyzers can register themselves
+// while static variables are initialized.
+Analyzer_Registry &analyzer_registry() {
+    static Analyzer_Registry registry;
+    return registry;
+}
+
+// REGISTER_ANALYZER makes the analyzer class available to the host
+// under the given name. Use it once per class after its definition
+//     REGISTER_ANALYZER(Mt_Channel, "mt");
+#define REGISTER_ANALYZER(type, name) \
+    static const bool registered_##type = analyzer_registry().Add(name, []() -> Analyzer * { return new type(); })
+
+// REGISTER_ANALYZER_CONFIG does the same for an analyzer that always
+// uses its own histogram config
+//     REGISTER_ANALYZER_CONFIG(Trigger_Study, "trigger_study", "configs/trigger_study.json");
+#define REGISTER_ANALYZER_CONFIG(type, name, histograms) \
+    static const bool registered_##type = analyzer_registry().Add(name, []() -> Analyzer * { return new type(); }, histograms)
+
+// Add registers an analyzer and, if given, its histogram config.
+// Throws if the name is already taken.
+bool Analyzer_Registry::Add(const std::string &name, Maker maker, const std::string &config) {
+    if (makers.count(name) > 0) {
+        throw std::invalid_argument("Analyzer_Registry: analyzer " + name + " is registered twice");
+    }
+    makers[name] = maker;
+    if (!config.empty()) {
+        histograms[name] = config;
+    }
+    return true;
+}
+
+// Make creates a new instance of the named analyzer. Throws if no
+// analyzer was registered with that name.
+std::unique_ptr<Analyzer> Analyzer_Registry::Make(const std::string &name) const {
+    auto maker = makers.find(name);
+    if (maker == makers.end()) {
+        throw std::invalid_argument("Analyzer_Registry: unknown analyzer " + name);
+    }
+    return std::unique_ptr<Analyzer>(maker->second());
+}
+
+// getNames returns the names of all registered analyzers.
+std::vector<std::string> Analyzer_Registry::getNames() const {
+    std::vector<std::string> names;
+    for (auto &maker : makers) {
+        names.push_back(maker.first);
+    }
+    return names;
+}
+
+// getHistograms returns the histogram config registered for the named
+// analyzer, or default_config if it didn't register one.
+std::string Analyzer_Registry::getHistograms(const std::string &name, const std::string &default_config) const {
+    auto config = histograms.find(name);
+    return config == histograms.end() ? default_config : config->second;
+}
+
+#endif  // INTERFACE_ANALYZER_H_
@@ -7,69 +7,93 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "./branch_registry.h"
+#include "./collection.h"
+#include "./p4.h"
 #include "./util.h"
-#include "TLorentzVector.h"
 #include "TTree.h"
 
 class Boosted;  // Boosted combines all boosted tau information
-typedef std::vector<Boosted> VBoosted;
+typedef Collection<Boosted> VBoosted;
 
-// Boosted combines all boosted tau related information along with
-// creating the boosted tau 4-vector. Helper functions are provided
-// to access properties of the boosted taus. These properties cannot
-// be updated.
+// Boosted gives access to all boosted tau related information along with
+// creating the boosted tau 4-vector. The information is stored in the
+// Columns of a VBoosted and the Boosted only points to its row, so it
+// is cheap to copy. All ID decisions are packed into a single word
+// per boosted tau (see tau_id_bit). Helper functions are provided to access
+// properties of the boosted taus. These properties cannot be updated.
 class Boosted {
-    friend class Boosted_Factory;  // Boosted_Factory constructs individual Boosteds
-
    public:
-    Boosted(Float_t _pt, Float_t _eta, Float_t _phi, Float_t _m) { this->p4.SetPtEtaPhiM(_pt, _eta, _phi, _m); }
-    Boosted() { this->p4.SetPtEtaPhiE(0, 0, 0, 0); }
+    // Columns holds every boosted tau variable for all boosted taus in the event.
+    struct Columns {
+        std::vector<Float_t> pt, eta, phi, mass, Iso, Charge, dz, dxy;
+        std::vector<Int_t> DecayMode;
+        std::vector<UShort_t> IDs;
+        void clear();
 
-    // getters
-    TLorentzVector getP4() { return p4; }
-    Float_t getPt() { return p4.Pt(); }
-    Float_t getEta() { return p4.Eta(); }
-    Float_t getPhi() { return p4.Phi(); }
-    Float_t getMass() { return p4.M(); }
-    Float_t getIsoRaw() { return Iso; }
-    Bool_t getIso(working_point);
-    Bool_t getDiscByDM(bool);
-    Bool_t getEleRejection(working_point);
-    Bool_t getMuRejection(working_point);
-    Int_t getDecayMode() { return DecayMode; }
-    Float_t getCharge() { return Charge; }
-    Float_t getDZ() { return dz; }
-    Float_t getDXY() { return dxy; }
+        // Visit calls f->Column(name, column) for every column, so all
+        // columns can be written to or read from a cache (column_cache.h).
+        template <typename C, typename F>
+        static void Visit(C &columns, F *f) {
+            f->Column("pt", columns.pt);
+            f->Column("eta", columns.eta);
+            f->Column("phi", columns.phi);
+            f->Column("mass", columns.mass);
+            f->Column("Iso", columns.Iso);
+            f->Column("Charge", columns.Charge);
+            f->Column("dz", columns.dz);
+            f->Column("dxy", columns.dxy);
+            f->Column("DecayMode", columns.DecayMode);
+            f->Column("IDs", columns.IDs);
+        }
+    };
 
-   private:
-    // these should never be modified once read from the TTree
-    TLorentzVector p4;
-    Bool_t pass_vloose_iso, pass_loose_iso, pass_medium_iso, pass_tight_iso, pass_vtight_iso;
+    Boosted() : columns(nullptr), row(0) {}
+    Boosted(const Columns *_columns, unsigned _row) : columns(_columns), row(_row) {}
 
-    Bool_t pfTausDiscriminationByDecayModeFinding, pfTausDiscriminationByDecayModeFindingNewDMs, ByMVA6VLooseElectronRejection,
-        ByMVA6LooseElectronRejection, ByMVA6MediumElectronRejection, ByMVA6TightElectronRejection, ByMVA6VTightElectronRejection,
-        ByLooseMuonRejection3, ByTightMuonRejection3;
+    // getters
+    PtEtaPhiM getP4() const { return PtEtaPhiM(getPt(), getEta(), getPhi(), getMass()); }
+    Float_t getPt() const { return columns->pt[row]; }
+    Float_t getEta() const { return columns->eta[row]; }
+    Float_t getPhi() const { return columns->phi[row]; }
+    Float_t getMass() const { return columns->mass[row]; }
+    Float_t getIsoRaw() const { return columns->Iso[row]; }
+    Bool_t getIso(working_point) const;
+    Bool_t getDiscByDM(bool) const;
+    Bool_t getEleRejection(working_point) const;
+    Bool_t getMuRejection(working_point) const;
+    Int_t getDecayMode() const { return columns->DecayMode[row]; }
+    Float_t getCharge() const { return columns->Charge[row]; }
+    Float_t getDZ() const { return columns->dz[row]; }
+    Float_t getDXY() const { return columns->dxy[row]; }
 
-    Int_t DecayMode;
+   private:
+    Bool_t hasID(int bit) const { return (columns->IDs[row] >> bit & 1) == 1; }
 
-    Float_t Charge, Mass, dz, dxy, Energy, Iso;
+    const Columns *columns;
+    unsigned row;
 };
 
 // Boosted_Factory reads from the TTree and constructs
 // individual Boosted objects. The Boosted_Factory holds the
-// list of boosted taus, but can provided a shared_ptr to the
-// list.
+// list of boosted taus. The list is handed out by
+// reference and is only valid until the next Run_Factory.
 class Boosted_Factory {
    public:
     explicit Boosted_Factory(TTree *, std::string);
     void Run_Factory();
+    Int_t Load(Long64_t entry) { return registry.Load(entry); }  // read only this factory's branches
+    template <typename F>
+    void Cache(F *);
 
     // getters
+    const std::vector<std::string> &getBranches() { return registry.getNames(); }  // branches read by this factory
     Int_t getNTotalBoosted() { return nBoostedTau; }  // nBoostedTau directly from TTree
     Int_t getNGoodBoosted() { return nGoodTaus; }     // nBoostedTau passing preselection
-    std::shared_ptr<VBoosted> getTaus() { return std::make_shared<VBoosted>(boosteds); }
+    const VBoosted &getTaus() const { return boosteds; }
 
    private:
+    Branch_Registry registry;
     Int_t nBoostedTau, nGoodTaus;
     VBoosted boosteds;
 
@@ -89,7 +113,8 @@ class Boosted_Factory {
 // The type of tau isolation can be chosen and defaults to
 // MVArun2v2DBOldDMwLT.
 Boosted_Factory::Boosted_Factory(TTree *tree, std::string isoType = "IsolationMVArun2v2DBoldDMwLT")
-    : boostedTauPt(nullptr),
+    : registry(tree),
+      boostedTauPt(nullptr),
       boostedTauEta(nullptr),
       boostedTauPhi(nullptr),
       boostedTauMass(nullptr),
@@ -112,85 +137,92 @@ Boosted_Factory::Boosted_Factory(TTree *tree, std::string isoType = "IsolationMV
       boostedTauCharge(nullptr),
       boostedTaudz(nullptr),
       boostedTaudxy(nullptr) {
-    tree->SetBranchAddress("nBoostedTau", &nBoostedTau);
-    tree->SetBranchAddress("boostedTauPt", &boostedTauPt);
-    tree->SetBranchAddress("boostedTauEta", &boostedTauEta);
-    tree->SetBranchAddress("boostedTauPhi", &boostedTauPhi);
-    tree->SetBranchAddress("boostedTauMass", &boostedTauMass);
+    registry.Bind("nBoostedTau", &nBoostedTau);
+    registry.Bind("boostedTauPt", &boostedTauPt);
+    registry.Bind("boostedTauEta", &boostedTauEta);
+    registry.Bind("boostedTauPhi", &boostedTauPhi);
+    registry.Bind("boostedTauMass", &boostedTauMass);
     // only 1-type of isolation available, for now
-    tree->SetBranchAddress("boostedTauByIsolationMVArun2v1DBoldDMwLTraw", &iso);
-    tree->SetBranchAddress("boostedTauByVLooseIsolationMVArun2v1DBoldDMwLT", &pass_vloose_iso);
-    tree->SetBranchAddress("boostedTauByLooseIsolationMVArun2v1DBoldDMwLT", &pass_loose_iso);
-    tree->SetBranchAddress("boostedTauByMediumIsolationMVArun2v1DBoldDMwLT", &pass_medium_iso);
-    tree->SetBranchAddress("boostedTauByTightIsolationMVArun2v1DBoldDMwLT", &pass_tight_iso);
-    tree->SetBranchAddress("boostedTauByVTightIsolationMVArun2v1DBoldDMwLT", &pass_vtight_iso);
-    tree->SetBranchAddress("boostedTaupfTausDiscriminationByDecayModeFinding", &boostedTaupfTausDiscriminationByDecayModeFinding);
-    tree->SetBranchAddress("boostedTaupfTausDiscriminationByDecayModeFindingNewDMs", &boostedTaupfTausDiscriminationByDecayModeFindingNewDMs);
-    tree->SetBranchAddress("boostedTauByMVA6VLooseElectronRejection", &boostedTauByMVA6VLooseElectronRejection);
-    tree->SetBranchAddress("boostedTauByMVA6LooseElectronRejection", &boostedTauByMVA6LooseElectronRejection);
-    tree->SetBranchAddress("boostedTauByMVA6MediumElectronRejection", &boostedTauByMVA6MediumElectronRejection);
-    tree->SetBranchAddress("boostedTauByMVA6TightElectronRejection", &boostedTauByMVA6TightElectronRejection);
-    tree->SetBranchAddress("boostedTauByMVA6VTightElectronRejection", &boostedTauByMVA6VTightElectronRejection);
-    tree->SetBranchAddress("boostedTauByLooseMuonRejection3", &boostedTauByLooseMuonRejection3);
-    tree->SetBranchAddress("boostedTauByTightMuonRejection3", &boostedTauByTightMuonRejection3);
-    tree->SetBranchAddress("boostedTauDecayMode", &boostedTauDecayMode);
-    tree->SetBranchAddress("boostedTauCharge", &boostedTauCharge);
-    tree->SetBranchAddress("boostedTaudz", &boostedTaudz);
-    tree->SetBranchAddress("boostedTaudxy", &boostedTaudxy);
+    registry.Bind("boostedTauByIsolationMVArun2v1DBoldDMwLTraw", &iso);
+    registry.Bind("boostedTauByVLooseIsolationMVArun2v1DBoldDMwLT", &pass_vloose_iso);
+    registry.Bind("boostedTauByLooseIsolationMVArun2v1DBoldDMwLT", &pass_loose_iso);
+    registry.Bind("boostedTauByMediumIsolationMVArun2v1DBoldDMwLT", &pass_medium_iso);
+    registry.Bind("boostedTauByTightIsolationMVArun2v1DBoldDMwLT", &pass_tight_iso);
+    registry.Bind("boostedTauByVTightIsolationMVArun2v1DBoldDMwLT", &pass_vtight_iso);
+    registry.Bind("boostedTaupfTausDiscriminationByDecayModeFinding", &boostedTaupfTausDiscriminationByDecayModeFinding);
+    registry.Bind("boostedTaupfTausDiscriminationByDecayModeFindingNewDMs", &boostedTaupfTausDiscriminationByDecayModeFindingNewDMs);
+    registry.Bind("boostedTauByMVA6VLooseElectronRejection", &boostedTauByMVA6VLooseElectronRejection);
+    registry.Bind("boostedTauByMVA6LooseElectronRejection", &boostedTauByMVA6LooseElectronRejection);
+    registry.Bind("boostedTauByMVA6MediumElectronRejection", &boostedTauByMVA6MediumElectronRejection);
+    registry.Bind("boostedTauByMVA6TightElectronRejection", &boostedTauByMVA6TightElectronRejection);
+    registry.Bind("boostedTauByMVA6VTightElectronRejection", &boostedTauByMVA6VTightElectronRejection);
+    registry.Bind("boostedTauByLooseMuonRejection3", &boostedTauByLooseMuonRejection3);
+    registry.Bind("boostedTauByTightMuonRejection3", &boostedTauByTightMuonRejection3);
+    registry.Bind("boostedTauDecayMode", &boostedTauDecayMode);
+    registry.Bind("boostedTauCharge", &boostedTauCharge);
+    registry.Bind("boostedTaudz", &boostedTaudz);
+    registry.Bind("boostedTaudxy", &boostedTaudxy);
 }
 
-// Called once per event to construct the Boosteds. A basic
-// preselection is applied to all boosted taus. All Boosteds passing
-// preselection are sorted by pT and stored.
+// Called once per event to fill the boosted tau columns. A basic
+// preselection is applied to all boosted taus. All boosted taus passing
+// preselection are stored and ordered by pT.
 void Boosted_Factory::Run_Factory() {
-    boosteds.clear();
+    auto &columns = boosteds.Reset();
     for (auto i = 0; i < nBoostedTau; i++) {
         // baseline/default selection
         if (boostedTauPt->at(i) < 20 || fabs(boostedTauEta->at(i)) > 2.3) {
             continue;
         }
-        auto boosted = Boosted(boostedTauPt->at(i), boostedTauEta->at(i), boostedTauPhi->at(i), boostedTauMass->at(i));
-        boosted.Iso = iso->at(i);
-        boosted.pass_vloose_iso = pass_vloose_iso->at(i);
-        boosted.pass_loose_iso = pass_loose_iso->at(i);
-        boosted.pass_medium_iso = pass_medium_iso->at(i);
-        boosted.pass_tight_iso = pass_tight_iso->at(i);
-        boosted.pass_vtight_iso = pass_vtight_iso->at(i);
-        boosted.pfTausDiscriminationByDecayModeFinding = boostedTaupfTausDiscriminationByDecayModeFinding->at(i);
-        boosted.pfTausDiscriminationByDecayModeFindingNewDMs = boostedTaupfTausDiscriminationByDecayModeFindingNewDMs->at(i);
-        boosted.ByMVA6VLooseElectronRejection = boostedTauByMVA6VLooseElectronRejection->at(i);
-        boosted.ByMVA6LooseElectronRejection = boostedTauByMVA6LooseElectronRejection->at(i);
-        boosted.ByMVA6MediumElectronRejection = boostedTauByMVA6MediumElectronRejection->at(i);
-        boosted.ByMVA6TightElectronRejection = boostedTauByMVA6TightElectronRejection->at(i);
-        boosted.ByMVA6VTightElectronRejection = boostedTauByMVA6VTightElectronRejection->at(i);
-        boosted.ByLooseMuonRejection3 = boostedTauByLooseMuonRejection3->at(i);
-        boosted.ByTightMuonRejection3 = boostedTauByTightMuonRejection3->at(i);
-        boosted.DecayMode = boostedTauDecayMode->at(i);
-        boosted.Charge = boostedTauCharge->at(i);
-        boosted.dz = boostedTaudz->at(i);
-        boosted.dxy = boostedTaudxy->at(i);
-        boosteds.push_back(boosted);
+        columns.pt.push_back(boostedTauPt->at(i));
+        columns.eta.push_back(boostedTauEta->at(i));
+        columns.phi.push_back(boostedTauPhi->at(i));
+        columns.mass.push_back(boostedTauMass->at(i));
+        columns.Iso.push_back(iso->at(i));
+        columns.Charge.push_back(boostedTauCharge->at(i));
+        columns.dz.push_back(boostedTaudz->at(i));
+        columns.dxy.push_back(boostedTaudxy->at(i));
+        columns.DecayMode.push_back(boostedTauDecayMode->at(i));
+
+        // pack all ID decisions
+        UShort_t ids(0);
+        ids |= pass_vloose_iso->at(i) << (iso_bit + vloose);
+        ids |= pass_loose_iso->at(i) << (iso_bit + loose);
+        ids |= pass_medium_iso->at(i) << (iso_bit + medium);
+        ids |= pass_tight_iso->at(i) << (iso_bit + tight);
+        ids |= pass_vtight_iso->at(i) << (iso_bit + vtight);
+        ids |= boostedTauByMVA6VLooseElectronRejection->at(i) << (ele_rejection_bit + vloose);
+        ids |= boostedTauByMVA6LooseElectronRejection->at(i) << (ele_rejection_bit + loose);
+        ids |= boostedTauByMVA6MediumElectronRejection->at(i) << (ele_rejection_bit + medium);
+        ids |= boostedTauByMVA6TightElectronRejection->at(i) << (ele_rejection_bit + tight);
+        ids |= boostedTauByMVA6VTightElectronRejection->at(i) << (ele_rejection_bit + vtight);
+        ids |= boostedTauByLooseMuonRejection3->at(i) << loose_mu_rejection_bit;
+        ids |= boostedTauByTightMuonRejection3->at(i) << tight_mu_rejection_bit;
+        ids |= boostedTaupfTausDiscriminationByDecayModeFinding->at(i) << dm_finding_bit;
+        ids |= boostedTaupfTausDiscriminationByDecayModeFindingNewDMs->at(i) << new_dm_finding_bit;
+        columns.IDs.push_back(ids);
     }
 
     // sort by pT
-    std::sort(boosteds.begin(), boosteds.end(), [](Boosted &p1, Boosted &p2) -> bool { return p1.getPt() > p2.getPt(); });
+    boosteds.Sort();
     nGoodTaus = boosteds.size();
 }
 
+// clear empties all columns while keeping their memory.
+void Boosted::Columns::clear() {
+    for (auto column : {&pt, &eta, &phi, &mass, &Iso, &Charge, &dz, &dxy}) {
+        column->clear();
+    }
+    DecayMode.clear();
+    IDs.clear();
+}
+
 // Check whether the tau passes isolation at
 // the provided working point. The type of isolation
 // is chosen in the Boosted_Factory constructor.
-Bool_t Boosted::getIso(working_point wp) {
-    if (wp == vloose) {
-        return pass_vloose_iso;
-    } else if (wp == loose) {
-        return pass_loose_iso;
-    } else if (wp == medium) {
-        return pass_medium_iso;
-    } else if (wp == tight) {
-        return pass_tight_iso;
-    } else if (wp == vtight) {
-        return pass_vtight_iso;
+Bool_t Boosted::getIso(working_point wp) const {
+    if (wp >= vloose && wp <= vtight) {
+        return hasID(iso_bit + wp);
     }
     throw std::invalid_argument("Must use one of the provided tau isolation WPs");
 }
@@ -198,39 +230,41 @@ Bool_t Boosted::getIso(working_point wp) {
 // Check whether the boosted tau passes decay mode finding.
 // New and old DMs are available with old being the
 // default option.
-Bool_t Boosted::getDiscByDM(bool newDM = false) {
+Bool_t Boosted::getDiscByDM(bool newDM = false) const {
     if (newDM) {
-        return pfTausDiscriminationByDecayModeFindingNewDMs;
+        return hasID(new_dm_finding_bit);
     }
-    return pfTausDiscriminationByDecayModeFinding;
+    return hasID(dm_finding_bit);
 }
 
 // Check whether the boosted tau passes electron rejection
 // at the requested working point.
-Bool_t Boosted::getEleRejection(working_point wp) {
-    if (wp == vloose) {
-        return ByMVA6VLooseElectronRejection;
-    } else if (wp == loose) {
-        return ByMVA6LooseElectronRejection;
-    } else if (wp == medium) {
-        return ByMVA6MediumElectronRejection;
-    } else if (wp == tight) {
-        return ByMVA6TightElectronRejection;
-    } else if (wp == vtight) {
-        return ByMVA6VTightElectronRejection;
+Bool_t Boosted::getEleRejection(working_point wp) const {
+    if (wp >= vloose && wp <= vtight) {
+        return hasID(ele_rejection_bit + wp);
     }
     throw std::invalid_argument("Must use one of the provided electron rejection WPs");
 }
 
 // Check whether the boosted tau passes muon rejection
 // at the requested working point.
-Bool_t Boosted::getMuRejection(working_point wp) {
+Bool_t Boosted::getMuRejection(working_point wp) const {
     if (wp == loose) {
-        return ByLooseMuonRejection3;
+        return hasID(loose_mu_rejection_bit);
     } else if (wp == tight) {
-        return ByTightMuonRejection3;
+        return hasID(tight_mu_rejection_bit);
     }
     throw std::invalid_argument("Muon rejection working point was neither Tight nor Loose");
 }
 
+// Cache hands the counters and the preselected taus of the current
+// event to a Column_Cache_Writer, or fills them from a
+// Column_Cache_Reader instead of running the factory.
+template <typename F>
+void Boosted_Factory::Cache(F *cache) {
+    cache->Scalar("nBoostedTau", &nBoostedTau);
+    cache->Scalar("nGoodTaus", &nGoodTaus);
+    cache->Objects("boosteds", &boosteds);
+}
+
 #endif  // INTERFACE_BOOSTED_FACTORY_H_
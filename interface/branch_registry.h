@@ -0,0 +1,94 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_BRANCH_REGISTRY_H_
+#define INTERFACE_BRANCH_REGISTRY_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+#include "TBranch.h"
+#include "TObjArray.h"
+#include "TTree.h"
+
+// Branch_Registry records every branch a factory binds to
+// the TTree. Binding a branch through the registry also
+// enables it, so the driver can disable the whole tree with
+// disable_all_branches before constructing any factories and
+// only the branches someone actually uses will be read.
+//
+// The registry also keeps the TBranch for every binding so a
+// factory can read its own branches with Load instead of relying
+// on a full TTree::GetEntry. This lets the driver decide which
+// objects are worth decompressing for each event.
+class Branch_Registry {
+   public:
+    explicit Branch_Registry(TTree *_tree) : tree(_tree) {}
+    template <typename T>
+    void Bind(std::string, T *);
+    Int_t Load(Long64_t);
+
+    // getters
+    TTree *getTree() { return tree; }
+    const std::vector<std::string> &getNames() const { return names; }
+
+   private:
+    TTree *tree;
+    std::vector<std::string> names;
+    std::deque<TBranch *> branches;  // deque so ROOT can keep pointers to the elements
+};
+
+// Bind enables the branch, sets the branch address and
+// remembers the branch name.
+template <typename T>
+void Branch_Registry::Bind(std::string name, T *address) {
+    branches.push_back(nullptr);
+    tree->SetBranchStatus(name.c_str(), 1);
+    tree->SetBranchAddress(name.c_str(), address, &branches.back());
+    names.push_back(name);
+}
+
+// Load reads all registered branches for the given entry of the
+// current tree (the value returned by TTree::LoadTree) and returns
+// the number of bytes read.
+Int_t Branch_Registry::Load(Long64_t entry) {
+    Int_t bytes(0);
+    for (auto branch : branches) {
+        if (branch != nullptr) {
+            bytes += branch->GetEntry(entry);
+        }
+    }
+    return bytes;
+}
+
+// disable_all_branches turns off every branch in the tree. This
+// must be called before the factories are constructed, otherwise
+// it will also disable the branches they registered.
+void disable_all_branches(TTree *tree) { tree->SetBranchStatus("*", 0); }
+
+// zip_bytes_per_event returns the average number of compressed
+// bytes stored per event. When only_active is true, disabled
+// branches are ignored, which gives the number of bytes that will
+// actually be read from disk. Otherwise, it gives the number of bytes
+// a full GetEntry would read.
+double zip_bytes_per_event(TTree *tree, bool only_active) {
+    // for a TChain, use whichever file is currently open
+    if (tree->GetTree() == nullptr) {
+        tree->LoadTree(0);
+    }
+    auto current = tree->GetTree();
+    if (current == nullptr || current->GetEntries() == 0) {
+        return 0.;
+    }
+    Long64_t bytes(0);
+    auto branches = current->GetListOfBranches();
+    for (auto i = 0; i < branches->GetEntries(); i++) {
+        auto branch = reinterpret_cast<TBranch *>(branches->At(i));
+        if (only_active && !current->GetBranchStatus(branch->GetName())) {
+            continue;
+        }
+        bytes += branch->GetZipBytes("*");
+    }
+    return static_cast<double>(bytes) / current->GetEntries();
+}
+
+#endif  // INTERFACE_BRANCH_REGISTRY_H_
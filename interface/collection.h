@@ -0,0 +1,96 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_COLLECTION_H_
+#define INTERFACE_COLLECTION_H_
+
+#include <algorithm>
+#include <vector>
+
+// Collection stores all objects of one type in an event as a
+// struct-of-arrays. T is the lightweight object class handed out
+// to analyzers (e.g. Muon) and T::Columns holds one contiguous
+// array per variable. Selections and sorting only touch the
+// arrays they need instead of walking through full objects.
+//
+// The columns are filled in the order of the TTree. Objects are
+// handed out in order of decreasing pT through the order index,
+// so the arrays never have to be shuffled. All arrays keep their
+// capacity between events, so no memory is allocated once the
+// largest event has been seen.
+template <typename T>
+class Collection {
+   public:
+    typedef typename T::Columns Columns;
+    class const_iterator;
+
+    typename T::Columns &Reset();
+    void Sort();
+
+    // getters
+    unsigned size() const { return order.size(); }
+    bool empty() const { return order.empty(); }
+    T at(unsigned i) const { return T(&columns, order.at(i)); }
+    T operator[](unsigned i) const { return T(&columns, order[i]); }
+    const Columns &getColumns() const { return columns; }           // arrays in TTree order
+    const std::vector<unsigned> &getOrder() const { return order; }  // rows in order of decreasing pT
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, order.size()); }
+
+   private:
+    Columns columns;
+    std::vector<unsigned> order;
+};
+
+// const_iterator lets a Collection be used in a range-based
+// for loop. It holds the current object so the loop variable
+// can be bound to a reference.
+template <typename T>
+class Collection<T>::const_iterator {
+   public:
+    const_iterator(const Collection<T> *_collection, unsigned _pos) : collection(_collection), pos(_pos) { update(); }
+    const T &operator*() const { return current; }
+    const T *operator->() const { return &current; }
+    const_iterator &operator++() {
+        ++pos;
+        update();
+        return *this;
+    }
+    bool operator!=(const const_iterator &other) const { return pos != other.pos; }
+    bool operator==(const const_iterator &other) const { return pos == other.pos; }
+
+   private:
+    void update() {
+        if (pos < collection->size()) {
+            current = (*collection)[pos];
+        }
+    }
+
+    const Collection<T> *collection;
+    unsigned pos;
+    T current;
+};
+
+// Reset empties the collection and returns the columns so the
+// factory can fill them for the next event. Sort must be called
+// once all objects have been added.
+template <typename T>
+typename T::Columns &Collection<T>::Reset() {
+    columns.clear();
+    order.clear();
+    return columns;
+}
+
+// Sort builds the order index so objects are handed out in order
+// of decreasing pT. Only the pT array is read while sorting.
+template <typename T>
+void Collection<T>::Sort() {
+    auto &pt = columns.pt;
+    order.resize(pt.size());
+    for (unsigned i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    // ties keep the TTree order
+    std::sort(order.begin(), order.end(), [&pt](unsigned i, unsigned j) -> bool { return pt[i] > pt[j] || (pt[i] == pt[j] && i < j); });
+}
+
+#endif  // INTERFACE_COLLECTION_H_
@@ -0,0 +1,389 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_COLUMN_CACHE_H_
+#define INTERFACE_COLUMN_CACHE_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./collection.h"
+#include "./event_loop.h"
+
+// The column cache stores what the factories produce for every event
+// of one Entry_Range in a flat binary file, so a later job can skip
+// reading and decompressing the TTree and rerunning the preselection.
+// A file looks like
+//     "BTCACHE1"                        magic, 8 bytes
+//     uint32 key size, key              identifies the input (files and tree)
+//     int64 first, last                 the Entry_Range
+//     uint64 ncolumns
+//     for every column:
+//         uint32 name size, name
+//         uint32 element size, uint64 element count, uint64 data offset
+//     data of every column, each starting on an 8 byte boundary
+// Scalars (e.g. "pfMET") have one element per event. The objects of a
+// collection (e.g. "muons.pt") are stored back to back for all events,
+// with "muons.offsets" holding the first row of every event and the
+// total number of rows at the end.
+//
+// The factories list their values with a Cache method and the columns
+// of their objects with Columns::Visit, which are called with either a
+// Column_Cache_Writer or a Column_Cache_Reader. The values are visited
+// in the same order for every event, so after the first event a column
+// is found by its position instead of its name.
+
+const char column_cache_magic[] = "BTCACHE1";
+
+// Column_Cache_Writer collects the columns of one range in memory
+// and writes them to a file once the range is done. A writer belongs
+// to a single thread.
+class Column_Cache_Writer {
+   public:
+    explicit Column_Cache_Writer(const std::string &_key) : key(_key), range(0, 0), nevents(0), cursor(0) {}
+    void Reset(const Entry_Range &);
+    void Next();
+    void Write(const std::string &) const;
+
+    // called by the factories
+    template <typename T>
+    void Scalar(const std::string &, const T *);
+    template <typename T>
+    void Objects(const std::string &, const Collection<T> *);
+    template <typename V>
+    void Column(const std::string &, const std::vector<V> &);
+
+   private:
+    struct Column_Data {
+        std::string name;
+        uint32_t elem_size;
+        std::vector<char> data;
+    };
+    Column_Data *Find(const std::string &, uint32_t);
+    template <typename V>
+    void Append(Column_Data *column, const V &value) {
+        auto bytes = reinterpret_cast<const char *>(&value);
+        column->data.insert(column->data.end(), bytes, bytes + sizeof(V));
+    }
+
+    std::string key;
+    Entry_Range range;
+    Long64_t nevents;
+    std::vector<Column_Data> columns;  // in the order they are visited
+    unsigned cursor;                   // next column to be visited in this event
+    std::string prefix;                // name of the collection being visited, e.g. "muons."
+};
+
+// Column_Cache_Reader maps a file written by a Column_Cache_Writer
+// into memory. Scalars are copied straight from the mapped pages and
+// the objects of an event are copied into the columns of the factory's
+// Collection, so analyzers see the same Muon, Jets, ... objects as when
+// running the factories. A reader belongs to a single thread.
+class Column_Cache_Reader {
+   public:
+    Column_Cache_Reader(const std::string &, const std::string &, const Entry_Range &);
+    ~Column_Cache_Reader();
+    Column_Cache_Reader(const Column_Cache_Reader &) = delete;
+    Column_Cache_Reader &operator=(const Column_Cache_Reader &) = delete;
+    void Seek(Long64_t);
+
+    // called by the factories
+    template <typename T>
+    void Scalar(const std::string &, T *);
+    template <typename T>
+    void Objects(const std::string &, Collection<T> *);
+    template <typename V>
+    void Column(const std::string &, std::vector<V> &);
+
+   private:
+    struct Column_Info {
+        std::string name;
+        uint32_t elem_size;
+        uint64_t count;
+        const char *data;  // inside the mapping
+    };
+    const Column_Info *Find(const std::string &, uint32_t);
+    template <typename T>
+    T Read_Header(size_t *);
+
+    std::string file_name;
+    Entry_Range range;
+    const char *mapping;
+    size_t size;
+    std::vector<Column_Info> columns;
+    std::vector<const Column_Info *> sequence;  // columns in the order they are visited
+    unsigned cursor;                            // next column to be visited in this event
+    Long64_t event;                             // position of the current event in the range
+    uint64_t row_begin, row_end;                // rows of the collection being visited
+    std::string prefix;                         // name of the collection being visited, e.g. "muons."
+};
+
+// cache_file_name returns the cache file of a range in dir. The
+// entries are part of the name, so the chunks of a job can share dir.
+std::string cache_file_name(const std::string &dir, const Entry_Range &range) {
+    return dir + "/range_" + std::to_string(range.first) + "_" + std::to_string(range.second) + ".cache";
+}
+
+// Reset drops all collected columns and starts the given range.
+void Column_Cache_Writer::Reset(const Entry_Range &_range) {
+    range = _range;
+    nevents = 0;
+    columns.clear();
+    cursor = 0;
+}
+
+// Next starts a new event. Must be called before the factories hand
+// over the values of the event.
+void Column_Cache_Writer::Next() {
+    nevents++;
+    cursor = 0;
+}
+
+// Find returns the column visited next. The first time a column is
+// visited, it is added after all known columns.
+Column_Cache_Writer::Column_Data *Column_Cache_Writer::Find(const std::string &name, uint32_t elem_size) {
+    if (cursor == columns.size()) {
+        columns.push_back(Column_Data{prefix + name, elem_size, std::vector<char>()});
+    }
+    return &columns[cursor++];
+}
+
+// Scalar appends one value of the current event.
+template <typename T>
+void Column_Cache_Writer::Scalar(const std::string &name, const T *value) {
+    prefix.clear();
+    Append(Find(name, sizeof(T)), *value);
+}
+
+// Objects appends the end row of the current event to name.offsets
+// followed by every column of the collection.
+template <typename T>
+void Column_Cache_Writer::Objects(const std::string &name, const Collection<T> *collection) {
+    prefix = name + ".";
+    auto known = cursor < columns.size();
+    auto offsets = Find("offsets", sizeof(uint64_t));
+    if (!known) {
+        Append(offsets, uint64_t(0));
+    }
+    uint64_t last_row(0);
+    std::memcpy(&last_row, offsets->data.data() + offsets->data.size() - sizeof(uint64_t), sizeof(uint64_t));
+    Append(offsets, last_row + collection->getColumns().pt.size());
+    T::Columns::Visit(collection->getColumns(), this);
+}
+
+// Column appends all rows of one column of a collection. Elements are
+// appended one at a time so std::vector<bool> is stored as plain bools.
+template <typename V>
+void Column_Cache_Writer::Column(const std::string &name, const std::vector<V> &column) {
+    auto data = Find(name, sizeof(V));
+    for (auto value : column) {
+        Append(data, static_cast<V>(value));
+    }
+}
+
+// Write stores all columns of the range in file_name. The file is
+// first written under a temporary name, so a job that is stopped never
+// leaves a partial cache behind. Throws if the file can't be written.
+void Column_Cache_Writer::Write(const std::string &file_name) const {
+    if (nevents != range.second - range.first) {
+        throw std::invalid_argument("Column_Cache_Writer: only " + std::to_string(nevents) + " events were added for " + file_name);
+    }
+    std::string header(column_cache_magic, 8);
+    auto add = [&header](const void *value, size_t nbytes) { header.append(reinterpret_cast<const char *>(value), nbytes); };
+    auto key_size = static_cast<uint32_t>(key.size());
+    add(&key_size, sizeof(key_size));
+    header += key;
+    int64_t first(range.first), last(range.second);
+    add(&first, sizeof(first));
+    add(&last, sizeof(last));
+    uint64_t ncolumns(columns.size());
+    add(&ncolumns, sizeof(ncolumns));
+
+    // the offsets depend on the header size, so it is sized first
+    uint64_t header_size(header.size());
+    for (auto &column : columns) {
+        header_size += sizeof(uint32_t) + column.name.size() + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+    }
+    uint64_t offset = (header_size + 7) / 8 * 8;
+    for (auto &column : columns) {
+        auto name_size = static_cast<uint32_t>(column.name.size());
+        uint64_t count(column.data.size() / column.elem_size);
+        add(&name_size, sizeof(name_size));
+        header += column.name;
+        add(&column.elem_size, sizeof(column.elem_size));
+        add(&count, sizeof(count));
+        add(&offset, sizeof(offset));
+        offset += (column.data.size() + 7) / 8 * 8;
+    }
+
+    auto temp_name = file_name + ".tmp";
+    std::ofstream fout(temp_name, std::ios::out | std::ios::binary | std::ios::trunc);
+    const char padding[8] = {0};
+    fout.write(header.data(), header.size());
+    fout.write(padding, (8 - header.size() % 8) % 8);
+    for (auto &column : columns) {
+        fout.write(column.data.data(), column.data.size());
+        fout.write(padding, (8 - column.data.size() % 8) % 8);
+    }
+    fout.close();
+    if (fout.fail() || std::rename(temp_name.c_str(), file_name.c_str()) != 0) {
+        throw std::invalid_argument("Column_Cache_Writer: unable to write " + file_name);
+    }
+}
+
+// Column_Cache_Reader maps file_name and reads the list of columns.
+// Throws if the file can't be read, or if it was written for another
+// input (key) or another range.
+Column_Cache_Reader::Column_Cache_Reader(const std::string &_file_name, const std::string &key, const Entry_Range &_range)
+    : file_name(_file_name), range(_range), mapping(nullptr), size(0), cursor(0), event(0), row_begin(0), row_end(0) {
+    auto fd = open(file_name.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::invalid_argument("Column_Cache_Reader: unable to open " + file_name);
+    }
+    size = info.st_size;
+    auto pages = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);  // the mapping stays valid
+    if (pages == MAP_FAILED) {
+        throw std::invalid_argument("Column_Cache_Reader: unable to map " + file_name);
+    }
+    mapping = static_cast<const char *>(pages);
+    madvise(pages, size, MADV_SEQUENTIAL);
+
+    try {
+        size_t pos(0);
+        if (size < 8 || std::memcmp(mapping, column_cache_magic, 8) != 0) {
+            throw std::invalid_argument("Column_Cache_Reader: " + file_name + " is not a column cache");
+        }
+        pos += 8;
+        auto key_size = Read_Header<uint32_t>(&pos);
+        if (pos + key_size > size || std::string(mapping + pos, key_size) != key) {
+            throw std::invalid_argument("Column_Cache_Reader: " + file_name + " was written for other input files");
+        }
+        pos += key_size;
+        auto first = Read_Header<int64_t>(&pos);
+        auto last = Read_Header<int64_t>(&pos);
+        if (first != range.first || last != range.second) {
+            throw std::invalid_argument("Column_Cache_Reader: " + file_name + " holds entries " + std::to_string(first) + " to " +
+                                        std::to_string(last) + " instead of " + std::to_string(range.first) + " to " +
+                                        std::to_string(range.second));
+        }
+        auto ncolumns = Read_Header<uint64_t>(&pos);
+        for (uint64_t i = 0; i < ncolumns; i++) {
+            auto name_size = Read_Header<uint32_t>(&pos);
+            if (pos + name_size > size) {
+                throw std::invalid_argument("Column_Cache_Reader: " + file_name + " is truncated");
+            }
+            std::string name(mapping + pos, name_size);
+            pos += name_size;
+            auto elem_size = Read_Header<uint32_t>(&pos);
+            auto count = Read_Header<uint64_t>(&pos);
+            auto offset = Read_Header<uint64_t>(&pos);
+            if (elem_size == 0 || offset % 8 != 0 || offset > size || count > (size - offset) / elem_size) {
+                throw std::invalid_argument("Column_Cache_Reader: " + file_name + " is truncated");
+            }
+            columns.push_back(Column_Info{name, elem_size, count, mapping + offset});
+        }
+    } catch (...) {
+        munmap(const_cast<char *>(mapping), size);
+        throw;
+    }
+}
+
+// ~Column_Cache_Reader unmaps the file.
+Column_Cache_Reader::~Column_Cache_Reader() {
+    munmap(const_cast<char *>(mapping), size);
+}
+
+// Read_Header reads one value of the header at pos and moves pos
+// past it.
+template <typename T>
+T Column_Cache_Reader::Read_Header(size_t *pos) {
+    if (*pos + sizeof(T) > size) {
+        throw std::invalid_argument("Column_Cache_Reader: " + file_name + " is truncated");
+    }
+    T value;
+    std::memcpy(&value, mapping + *pos, sizeof(T));
+    *pos += sizeof(T);
+    return value;
+}
+
+// Seek moves to entry i of the TTree, which has to be inside the range
+// of the file.
+void Column_Cache_Reader::Seek(Long64_t i) {
+    if (i < range.first || i >= range.second) {
+        throw std::out_of_range("Column_Cache_Reader: entry " + std::to_string(i) + " is not in " + file_name);
+    }
+    event = i - range.first;
+    cursor = 0;
+}
+
+// Find returns the column visited next. The first time a column is
+// visited, it is looked up by name and its element size is checked,
+// so a cache written by an older version of a factory is rejected.
+const Column_Cache_Reader::Column_Info *Column_Cache_Reader::Find(const std::string &name, uint32_t elem_size) {
+    if (cursor == sequence.size()) {
+        const Column_Info *found(nullptr);
+        for (auto &column : columns) {
+            if (column.name == prefix + name) {
+                found = &column;
+            }
+        }
+        if (found == nullptr || found->elem_size != elem_size) {
+            throw std::invalid_argument("Column_Cache_Reader: no column " + prefix + name + " of the expected type in " + file_name);
+        }
+        sequence.push_back(found);
+    }
+    return sequence[cursor++];
+}
+
+// Scalar copies the value of the current event.
+template <typename T>
+void Column_Cache_Reader::Scalar(const std::string &name, T *value) {
+    prefix.clear();
+    auto column = Find(name, sizeof(T));
+    if (static_cast<uint64_t>(event) >= column->count) {
+        throw std::invalid_argument("Column_Cache_Reader: column " + name + " is too short in " + file_name);
+    }
+    std::memcpy(value, column->data + event * sizeof(T), sizeof(T));
+}
+
+// Objects fills the collection with the rows of the current event
+// and sorts it, the same as the factory would.
+template <typename T>
+void Column_Cache_Reader::Objects(const std::string &name, Collection<T> *collection) {
+    prefix = name + ".";
+    auto offsets = Find("offsets", sizeof(uint64_t));
+    if (static_cast<uint64_t>(event) + 1 >= offsets->count) {
+        throw std::invalid_argument("Column_Cache_Reader: column " + prefix + "offsets is too short in " + file_name);
+    }
+    auto rows = reinterpret_cast<const uint64_t *>(offsets->data);
+    row_begin = rows[event];
+    row_end = rows[event + 1];
+    T::Columns::Visit(collection->Reset(), this);
+    collection->Sort();
+}
+
+// Column copies the rows of the current event into one column of a
+// collection. The column keeps its capacity between events.
+template <typename V>
+void Column_Cache_Reader::Column(const std::string &name, std::vector<V> &column) {
+    auto info = Find(name, sizeof(V));
+    if (row_begin > row_end || row_end > info->count) {
+        throw std::invalid_argument("Column_Cache_Reader: column " + prefix + name + " is too short in " + file_name);
+    }
+    auto data = reinterpret_cast<const V *>(info->data);
+    column.assign(data + row_begin, data + row_end);
+}
+
+#endif  // INTERFACE_COLUMN_CACHE_H_
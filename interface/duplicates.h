@@ -0,0 +1,193 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_DUPLICATES_H_
+#define INTERFACE_DUPLICATES_H_
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "./branch_registry.h"
+#include "./event_loop.h"
+#include "./input_files.h"
+#include "./lumi_mask.h"
+#include "TChain.h"
+
+// Duplicate_Finder finds the events stored more than once in a chain,
+// e.g. an event recorded by both the muon and the electron triggers
+// shows up in SingleMuon and in SingleElectron. An event is identified
+// by (run, lumis, event) and the first entry in the chain is kept, so
+// every chunk and thread of a job removes the same entries.
+//
+// Duplicates can only be in lumi sections stored in more than one
+// block, which the lumi index of every file (see lumi_mask.h) already
+// lists. Only the event branch of those blocks is read, one lumi
+// section at a time, so the memory needed is the hash set of a single
+// lumi section plus the list of duplicate entries.
+class Duplicate_Finder {
+   public:
+    Duplicate_Finder(const std::vector<std::string> &, const std::vector<Long64_t> &, const std::string &, const std::string &);
+    std::vector<Long64_t> Find();
+
+   private:
+    // Event_Reader reads only the event branch of one file
+    struct Event_Reader {
+        explicit Event_Reader(std::shared_ptr<TChain> _chain) : chain(_chain), registry(_chain.get()), event(0) {
+            disable_all_branches(chain.get());
+            registry.Bind("event", &event);
+        }
+        std::shared_ptr<TChain> chain;
+        Branch_Registry registry;
+        Long64_t event;
+    };
+    Event_Reader *Reader(unsigned);
+    std::vector<Long64_t> Scan();
+
+    std::vector<std::string> files;
+    std::vector<Long64_t> entries;
+    std::string tree_name, cache_dir, key;
+    std::vector<std::unique_ptr<Event_Reader>> readers;  // opened the first time a file is needed
+};
+
+// The Duplicate_Finder constructor stores the files of the chain and
+// the number of entries in each (see entries_per_file). The lumi
+// indices and the list of duplicates are cached in cache_dir.
+Duplicate_Finder::Duplicate_Finder(const std::vector<std::string> &_files, const std::vector<Long64_t> &_entries, const std::string &_tree_name,
+                                   const std::string &_cache_dir)
+    : files(_files), entries(_entries), tree_name(_tree_name), cache_dir(_cache_dir), readers(_files.size()) {
+    key = "duplicates " + tree_name;
+    for (unsigned i = 0; i < files.size(); i++) {
+        key += " " + files.at(i) + " " + std::to_string(entries.at(i));
+    }
+}
+
+// Find returns the sorted entries of the chain holding an event that
+// is already stored in an earlier entry. The list is read from
+// cache_dir if the same files were scanned before. A new list is only
+// moved into cache_dir once it is complete.
+std::vector<Long64_t> Duplicate_Finder::Find() {
+    std::stringstream name;
+    name << cache_dir << "/duplicates_" << std::hex << std::hash<std::string>()(key) << ".txt";
+
+    std::ifstream fin(name.str());
+    std::string line;
+    if (std::getline(fin, line) && line == key) {
+        size_t nduplicates(0);
+        fin >> nduplicates;
+        std::vector<Long64_t> duplicates(nduplicates);
+        for (auto &entry : duplicates) {
+            fin >> entry;
+        }
+        if (!fin.fail()) {
+            return duplicates;
+        }
+    }
+
+    auto duplicates = Scan();
+    auto temp_name = temp_file_name(name.str());
+    std::ofstream fout(temp_name, std::ios::out | std::ios::trunc);
+    fout << key << std::endl;
+    fout << duplicates.size() << std::endl;
+    for (auto entry : duplicates) {
+        fout << entry << std::endl;
+    }
+    replace_file(&fout, temp_name, name.str());
+    return duplicates;
+}
+
+// Reader returns the reader of file i, opening the file if needed.
+Duplicate_Finder::Event_Reader *Duplicate_Finder::Reader(unsigned i) {
+    if (readers.at(i) == nullptr) {
+        readers.at(i).reset(new Event_Reader(build_chain({files.at(i)}, tree_name, {entries.at(i)})));
+    }
+    return readers.at(i).get();
+}
+
+// Scan groups the lumi blocks of all files by lumi section and reads
+// the event numbers of every section stored in more than one block.
+// The blocks of a section are visited in chain order and every event
+// number already in the hash set is a duplicate. A file is closed
+// after the last section it holds, so only the files covering the
+// current lumi sections are open at any time.
+std::vector<Long64_t> Duplicate_Finder::Scan() {
+    // (file, position in the chain) of every block, grouped by lumi section
+    typedef std::pair<unsigned, Lumi_Block> File_Block;
+    std::map<std::pair<Int_t, Int_t>, std::vector<File_Block>> sections;
+    for (unsigned i = 0; i < files.size(); i++) {
+        for (auto &block : file_lumi_index(files.at(i), tree_name, cache_dir).getBlocks()) {
+            sections[std::make_pair(block.run, block.lumi)].push_back(std::make_pair(i, block));
+        }
+    }
+
+    std::vector<Long64_t> offsets(1, 0);
+    for (auto nentries : entries) {
+        offsets.push_back(offsets.back() + nentries);
+    }
+
+    // last section (in the order they are scanned) read from every file
+    std::vector<unsigned> last_section(files.size(), 0);
+    unsigned isection(0);
+    for (auto &section : sections) {
+        if (section.second.size() > 1) {
+            for (auto &file_block : section.second) {
+                last_section.at(file_block.first) = isection;
+            }
+            isection++;
+        }
+    }
+
+    std::vector<Long64_t> duplicates;
+    std::unordered_set<Long64_t> seen;
+    isection = 0;
+    for (auto &section : sections) {
+        if (section.second.size() < 2) {
+            continue;
+        }
+        seen.clear();
+        for (auto &file_block : section.second) {
+            auto reader = Reader(file_block.first);
+            for (auto i = file_block.second.first; i < file_block.second.last; i++) {
+                reader->registry.Load(reader->chain->LoadTree(i));
+                if (!seen.insert(reader->event).second) {
+                    duplicates.push_back(offsets.at(file_block.first) + i);
+                }
+            }
+        }
+        for (auto &file_block : section.second) {
+            if (last_section.at(file_block.first) == isection) {
+                readers.at(file_block.first).reset();  // close the file
+            }
+        }
+        isection++;
+    }
+    std::sort(duplicates.begin(), duplicates.end());
+    return duplicates;
+}
+
+// remove_entries returns the sorted ranges without the sorted entries.
+std::vector<Entry_Range> remove_entries(const std::vector<Entry_Range> &ranges, const std::vector<Long64_t> &removed) {
+    std::vector<Entry_Range> kept;
+    auto entry = removed.begin();
+    for (auto &range : ranges) {
+        auto first = range.first;
+        entry = std::lower_bound(entry, removed.end(), first);
+        for (; entry != removed.end() && *entry < range.second; ++entry) {
+            if (*entry > first) {
+                kept.push_back(std::make_pair(first, *entry));
+            }
+            first = *entry + 1;
+        }
+        if (first < range.second) {
+            kept.push_back(std::make_pair(first, range.second));
+        }
+    }
+    return kept;
+}
+
+#endif  // INTERFACE_DUPLICATES_H_
@@ -5,64 +5,95 @@
 
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
+#include "./branch_registry.h"
+#include "./collection.h"
+#include "./p4.h"
 #include "./util.h"
-#include "TLorentzVector.h"
 #include "TTree.h"
 
-class Electron;  // Electorn combines all electron information
-typedef std::vector<Electron> VElectron;
+class Electron;  // Electron combines all electron information
+typedef Collection<Electron> VElectron;
 
-// Electron combines all electron related information along with
-// creating the electron 4-vector. Helper functions are provided
-// to access properties of the electrons. These properties cannot
-// be updated.
+// Electron gives access to all electron related information along
+// with creating the electron 4-vector. The information is stored in
+// the Columns of a VElectron and the Electron only points to its row,
+// so it is cheap to copy. Helper functions are provided to access
+// properties of the electrons. These properties cannot be updated.
 class Electron {
-    friend class Electron_Factory;  // Electron_Factory constructs individual Electrons
-
    public:
-    Electron(Float_t _pt, Float_t _eta, Float_t _phi, Float_t _en) { this->p4.SetPtEtaPhiE(_pt, _eta, _phi, _en); }
-    Electron() { this->p4.SetPtEtaPhiE(0, 0, 0, 0); }
+    // Columns holds every electron variable for all electrons in the event.
+    struct Columns {
+        std::vector<Float_t> pt, eta, phi, mass, D0, Dz, IDMVAIso, IDMVANoIso, eleSCEta;
+        std::vector<Int_t> Charge, ConvVeto, MissHits;
+        std::vector<Short_t> IDbit;
+        void clear();
+
+        // Visit calls f->Column(name, column) for every column, so all
+        // columns can be written to or read from a cache (column_cache.h).
+        template <typename C, typename F>
+        static void Visit(C &columns, F *f) {
+            f->Column("pt", columns.pt);
+            f->Column("eta", columns.eta);
+            f->Column("phi", columns.phi);
+            f->Column("mass", columns.mass);
+            f->Column("D0", columns.D0);
+            f->Column("Dz", columns.Dz);
+            f->Column("IDMVAIso", columns.IDMVAIso);
+            f->Column("IDMVANoIso", columns.IDMVANoIso);
+            f->Column("eleSCEta", columns.eleSCEta);
+            f->Column("Charge", columns.Charge);
+            f->Column("ConvVeto", columns.ConvVeto);
+            f->Column("MissHits", columns.MissHits);
+            f->Column("IDbit", columns.IDbit);
+        }
+    };
+
+    Electron() : columns(nullptr), row(0) {}
+    Electron(const Columns *_columns, unsigned _row) : columns(_columns), row(_row) {}
 
     // getters
-    TLorentzVector getP4() { return p4; }
-    Int_t getCharge() { return Charge; }
-    Int_t getConvVeto() { return ConvVeto; }
-    Int_t getMissHits() { return MissHits; }
-    Float_t getPt() { return p4.Pt(); }
-    Float_t getEta() { return p4.Eta(); }
-    Float_t getPhi() { return p4.Phi(); }
-    Float_t getMass() { return p4.M(); }
-    Float_t getD0() { return D0; }
-    Float_t getDz() { return Dz; }
-    Float_t getSCEta() { return eleSCEta; }
-    Bool_t getIDMVAIso() { return IDMVAIso; }
-    Bool_t getIDMVANoIso() { return IDMVANoIso; }
-    Bool_t getID(working_point key) { return (IDbit >> key & 1) == 1; }
+    PtEtaPhiM getP4() const { return PtEtaPhiM(getPt(), getEta(), getPhi(), getMass()); }
+    Int_t getCharge() const { return columns->Charge[row]; }
+    Int_t getConvVeto() const { return columns->ConvVeto[row]; }
+    Int_t getMissHits() const { return columns->MissHits[row]; }
+    Float_t getPt() const { return columns->pt[row]; }
+    Float_t getEta() const { return columns->eta[row]; }
+    Float_t getPhi() const { return columns->phi[row]; }
+    Float_t getMass() const { return columns->mass[row]; }
+    Float_t getD0() const { return columns->D0[row]; }
+    Float_t getDz() const { return columns->Dz[row]; }
+    Float_t getSCEta() const { return columns->eleSCEta[row]; }
+    Bool_t getIDMVAIso() const { return columns->IDMVAIso[row]; }
+    Bool_t getIDMVANoIso() const { return columns->IDMVANoIso[row]; }
+    Bool_t getID(working_point key) const { return (columns->IDbit[row] >> key & 1) == 1; }
 
    private:
-    // these should never be modified once read from the TTree
-    TLorentzVector p4;
-    Short_t IDbit;
-    Int_t Charge, ConvVeto, MissHits;
-    Float_t D0, Dz, IDMVAIso, IDMVANoIso, eleSCEta;
+    const Columns *columns;
+    unsigned row;
 };
 
 // Electron_Factory reads from the TTree and constructs
 // individual Electron objects. The Electron_Factory holds the
-// list of electrons, but can provided a shared_ptr to the
-// list.
+// list of electrons. The list is handed out by
+// reference and is only valid until the next Run_Factory.
 class Electron_Factory {
    public:
     explicit Electron_Factory(TTree *);
     void Run_Factory();
+    Int_t Load(Long64_t entry) { return registry.Load(entry); }  // read only this factory's branches
+    template <typename F>
+    void Cache(F *);
 
     // getters
+    const std::vector<std::string> &getBranches() { return registry.getNames(); }  // branches read by this factory
     Int_t getNTotalElectron() { return nEle; }     // nEle directly from TTree
     Int_t getNGoodElectron() { return nGoodEle; }  // nEle passing preselection
-    std::shared_ptr<VElectron> getElectrons() { return std::make_shared<VElectron>(electrons); }
+    const VElectron &getElectrons() const { return electrons; }
 
    private:
+    Branch_Registry registry;
     Int_t nEle, nGoodEle;
     VElectron electrons;
     std::vector<Short_t> *eleIDbit;
@@ -72,7 +103,8 @@ class Electron_Factory {
 
 // Set all branch addresses when constructing a Electron_Factory.
 Electron_Factory::Electron_Factory(TTree *tree)
-    : eleCharge(nullptr),
+    : registry(tree),
+      eleCharge(nullptr),
       eleEn(nullptr),
       eleD0(nullptr),
       eleDz(nullptr),
@@ -85,47 +117,70 @@ Electron_Factory::Electron_Factory(TTree *tree)
       eleIDMVANoIso(nullptr),
       eleIDbit(nullptr),
       eleSCEta(nullptr) {
-    tree->SetBranchAddress("nEle", &nEle);
-    tree->SetBranchAddress("eleCharge", &eleCharge);
-    tree->SetBranchAddress("eleD0", &eleD0);
-    tree->SetBranchAddress("eleDz", &eleDz);
-    tree->SetBranchAddress("elePt", &elePt);
-    tree->SetBranchAddress("eleEn", &eleEn);
-    tree->SetBranchAddress("eleEta", &eleEta);
-    tree->SetBranchAddress("elePhi", &elePhi);
-    tree->SetBranchAddress("eleConvVeto", &eleConvVeto);
-    tree->SetBranchAddress("eleMissHits", &eleMissHits);
-    tree->SetBranchAddress("eleIDMVAIso", &eleIDMVAIso);
-    tree->SetBranchAddress("eleIDMVANoIso", &eleIDMVANoIso);
-    tree->SetBranchAddress("eleIDbit", &eleIDbit);
-    tree->SetBranchAddress("eleSCEta", &eleSCEta);
+    registry.Bind("nEle", &nEle);
+    registry.Bind("eleCharge", &eleCharge);
+    registry.Bind("eleD0", &eleD0);
+    registry.Bind("eleDz", &eleDz);
+    registry.Bind("elePt", &elePt);
+    registry.Bind("eleEn", &eleEn);
+    registry.Bind("eleEta", &eleEta);
+    registry.Bind("elePhi", &elePhi);
+    registry.Bind("eleConvVeto", &eleConvVeto);
+    registry.Bind("eleMissHits", &eleMissHits);
+    registry.Bind("eleIDMVAIso", &eleIDMVAIso);
+    registry.Bind("eleIDMVANoIso", &eleIDMVANoIso);
+    registry.Bind("eleIDbit", &eleIDbit);
+    registry.Bind("eleSCEta", &eleSCEta);
 }
 
-// Called once per event to construct the Electrons. A basic
-// preselection is applied to all electrons. All Electrons passing
-// preselection are sorted by pT and stored.
+// Called once per event to fill the electron columns. A basic
+// preselection is applied to all electrons. All electrons passing
+// preselection are stored and ordered by pT.
 void Electron_Factory::Run_Factory() {
-    electrons.clear();
+    auto &columns = electrons.Reset();
     for (auto i = 0; i < nEle; i++) {
         if (elePt->at(i) < 10 || fabs(eleEta->at(i)) > 2.5) {
             continue;
         }
-        auto electron = Electron(elePt->at(i), eleEta->at(i), elePhi->at(i), eleEn->at(i));
-        electron.Charge = eleCharge->at(i);
-        electron.D0 = eleD0->at(i);
-        electron.Dz = eleDz->at(i);
-        electron.ConvVeto = eleConvVeto->at(i);
-        electron.MissHits = eleMissHits->at(i);
-        electron.IDMVAIso = eleIDMVAIso->at(i);
-        electron.IDMVANoIso = eleIDMVANoIso->at(i);
-        electron.IDbit = eleIDbit->at(i);
-        electron.eleSCEta = eleSCEta->at(i);
-        electrons.push_back(electron);
+        columns.pt.push_back(elePt->at(i));
+        columns.eta.push_back(eleEta->at(i));
+        columns.phi.push_back(elePhi->at(i));
+        columns.mass.push_back(PtEtaPhiM::FromPtEtaPhiE(elePt->at(i), eleEta->at(i), elePhi->at(i), eleEn->at(i)).M());
+        columns.Charge.push_back(eleCharge->at(i));
+        columns.D0.push_back(eleD0->at(i));
+        columns.Dz.push_back(eleDz->at(i));
+        columns.ConvVeto.push_back(eleConvVeto->at(i));
+        columns.MissHits.push_back(eleMissHits->at(i));
+        columns.IDMVAIso.push_back(eleIDMVAIso->at(i));
+        columns.IDMVANoIso.push_back(eleIDMVANoIso->at(i));
+        columns.IDbit.push_back(eleIDbit->at(i));
+        columns.eleSCEta.push_back(eleSCEta->at(i));
     }
 
     // sort by pT
-    std::sort(electrons.begin(), electrons.end(), [](Electron &p1, Electron &p2) -> bool { return p1.getPt() > p2.getPt(); });
+    electrons.Sort();
     nGoodEle = electrons.size();
 }
 
+// clear empties all columns while keeping their memory.
+void Electron::Columns::clear() {
+    for (auto column : {&pt, &eta, &phi, &mass, &D0, &Dz, &IDMVAIso, &IDMVANoIso, &eleSCEta}) {
+        column->clear();
+    }
+    for (auto column : {&Charge, &ConvVeto, &MissHits}) {
+        column->clear();
+    }
+    IDbit.clear();
+}
+
+// Cache hands the counters and the preselected electrons of the current
+// event to a Column_Cache_Writer, or fills them from a
+// Column_Cache_Reader instead of running the factory.
+template <typename F>
+void Electron_Factory::Cache(F *cache) {
+    cache->Scalar("nEle", &nEle);
+    cache->Scalar("nGoodEle", &nGoodEle);
+    cache->Objects("electrons", &electrons);
+}
+
 #endif  // INTERFACE_ELECTRON_FACTORY_H_
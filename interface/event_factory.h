@@ -3,53 +3,126 @@
 #ifndef INTERFACE_EVENT_FACTORY_H_
 #define INTERFACE_EVENT_FACTORY_H_
 
+#include <string>
 #include <vector>
-#include "TLorentzVector.h"
+#include "./branch_registry.h"
+#include "./p4.h"
 #include "TTree.h"
 
+// enum for the three words holding the HLT bits of an event
+enum trigger_word {
+  lep_word,  // HLTEleMuX
+  pho_word,  // HLTPho
+  jet_word   // HLTJet
+};
+
 // EventFactory combines all event level information
 // and provides methods to access it. The EventFactory
 // handles all the bit-shifts required to apply triggers.
 class Event_Factory {
  public:
-  explicit Event_Factory(TTree*);
-  void Run_Factory() { MET.SetPtEtaPhiE(pfMET, 0, pfMETPhi, 0); }
+  Event_Factory(TTree*, bool);
+  void Run_Factory();
+  Int_t Load(Long64_t entry) { return registry.Load(entry); }  // read only this factory's branches
+  template <typename F>
+  void Cache(F *);
   Bool_t getLepTrigger(int key) { return (HLTEleMuX >> key & 1) == 1; }
   Bool_t getPhoTrigger(int key) { return (HLTPho >> key & 1) == 1; }
   Bool_t getJetTrigger(int key) { return (HLTJet >> key & 1) == 1; }
   Bool_t getLepTriggerIsPre(int key) { return (HLTEleMuXIsPrescaled >> key & 1) == 1; }
   Bool_t getPhoTriggerIsPre(int key) { return (HLTPhoIsPrescaled >> key & 1) == 1; }
   Bool_t getJetTriggerIsPre(int key) { return (HLTJetIsPrescaled >> key & 1) == 1; }
+  ULong64_t getTriggerWord(trigger_word word) { return word == lep_word ? HLTEleMuX : word == pho_word ? HLTPho : HLTJet; }
   Int_t getRun() { return run; }
   Int_t getLumi() { return lumis; }
   Long64_t getEvent() { return evt; }
-  TLorentzVector getMET() { return MET; }
+  PtEtaPhiM getMET() { return MET; }
+  Int_t getNPU() { return n_pu; }
+  Float_t getTruePU() { return true_pu; }
+  const std::vector<std::string> &getBranches() { return registry.getNames(); }  // branches read by this factory
 
  private:
-  std::vector<int> *nPU, *puTrue;
+  template <typename T>
+  T In_Time(const std::vector<T> *) const;
+
+  Branch_Registry registry;
+  Bool_t is_data;
+  std::vector<int> *nPU, *puBX;
+  std::vector<float> *puTrue;
   Long64_t evt;
   ULong64_t HLTEleMuX, HLTPho, HLTJet, HLTEleMuXIsPrescaled, HLTPhoIsPrescaled, HLTJetIsPrescaled;
   Int_t run, lumis;
   Float_t rho, pfMET, pfMETPhi;
-  TLorentzVector MET;
+  Int_t n_pu;      // in-time pileup
+  Float_t true_pu;
+  PtEtaPhiM MET;
 };
 
-// SetBranchAddresses when constructing an Event_Factory.
-Event_Factory::Event_Factory(TTree* tree) {
-  tree->SetBranchAddress("HLTEleMuX", &HLTEleMuX);
-  tree->SetBranchAddress("HLTPho", &HLTPho);
-  tree->SetBranchAddress("HLTJet", &HLTJet);
-  tree->SetBranchAddress("HLTEleMuXIsPrescaled", &HLTEleMuXIsPrescaled);
-  tree->SetBranchAddress("HLTPhoIsPrescaled", &HLTPhoIsPrescaled);
-  tree->SetBranchAddress("HLTJetIsPrescaled", &HLTJetIsPrescaled);
-  // tree->SetBranchAddress("nPU", &nPU);
-  // tree->SetBranchAddress("puTrue", &puTrue);
-  tree->SetBranchAddress("event", &evt);
-  tree->SetBranchAddress("run", &run);
-  tree->SetBranchAddress("lumis", &lumis);
-  tree->SetBranchAddress("rho", &rho);
-  tree->SetBranchAddress("pfMET", &pfMET);
-  tree->SetBranchAddress("pfMETPhi", &pfMETPhi);
+// SetBranchAddresses when constructing an Event_Factory. The
+// pileup branches only exist in simulation.
+Event_Factory::Event_Factory(TTree* tree, bool is_data_)
+    : registry(tree), is_data(is_data_), nPU(nullptr), puBX(nullptr), puTrue(nullptr), n_pu(0), true_pu(0) {
+  registry.Bind("HLTEleMuX", &HLTEleMuX);
+  registry.Bind("HLTPho", &HLTPho);
+  registry.Bind("HLTJet", &HLTJet);
+  registry.Bind("HLTEleMuXIsPrescaled", &HLTEleMuXIsPrescaled);
+  registry.Bind("HLTPhoIsPrescaled", &HLTPhoIsPrescaled);
+  registry.Bind("HLTJetIsPrescaled", &HLTJetIsPrescaled);
+  if (!is_data) {
+    registry.Bind("nPU", &nPU);
+    registry.Bind("puBX", &puBX);
+    registry.Bind("puTrue", &puTrue);
+  }
+  registry.Bind("event", &evt);
+  registry.Bind("run", &run);
+  registry.Bind("lumis", &lumis);
+  registry.Bind("rho", &rho);
+  registry.Bind("pfMET", &pfMET);
+  registry.Bind("pfMETPhi", &pfMETPhi);
+}
+
+// Run_Factory builds the MET and finds the in-time pileup.
+void Event_Factory::Run_Factory() {
+  MET = PtEtaPhiM(pfMET, 0, pfMETPhi, 0);
+  n_pu = In_Time(nPU);
+  true_pu = In_Time(puTrue);
+}
+
+// Cache hands all event-level values to a Column_Cache_Writer, or
+// fills them from a Column_Cache_Reader instead of running the factory.
+template <typename F>
+void Event_Factory::Cache(F *cache) {
+  cache->Scalar("HLTEleMuX", &HLTEleMuX);
+  cache->Scalar("HLTPho", &HLTPho);
+  cache->Scalar("HLTJet", &HLTJet);
+  cache->Scalar("HLTEleMuXIsPrescaled", &HLTEleMuXIsPrescaled);
+  cache->Scalar("HLTPhoIsPrescaled", &HLTPhoIsPrescaled);
+  cache->Scalar("HLTJetIsPrescaled", &HLTJetIsPrescaled);
+  cache->Scalar("event", &evt);
+  cache->Scalar("run", &run);
+  cache->Scalar("lumis", &lumis);
+  cache->Scalar("rho", &rho);
+  cache->Scalar("pfMET", &pfMET);
+  cache->Scalar("pfMETPhi", &pfMETPhi);
+  cache->Scalar("nPU", &n_pu);
+  cache->Scalar("puTrue", &true_pu);
+  MET = PtEtaPhiM(pfMET, 0, pfMETPhi, 0);  // not stored, rebuilt from the cached values
+}
+
+// In_Time returns the pileup value of the in-time bunch crossing
+// (puBX == 0). The pileup branches hold one value per bunch crossing.
+// Always 0 in data.
+template <typename T>
+T Event_Factory::In_Time(const std::vector<T> *values) const {
+  if (is_data) {
+    return 0;
+  }
+  for (unsigned i = 0; i < puBX->size(); i++) {
+    if (puBX->at(i) == 0) {
+      return values->at(i);
+    }
+  }
+  return 0;
 }
 
 #endif  // INTERFACE_EVENT_FACTORY_H_
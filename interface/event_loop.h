@@ -0,0 +1,254 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_EVENT_LOOP_H_
+#define INTERFACE_EVENT_LOOP_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "TChain.h"
+#include "TTree.h"
+
+// Entry_Range holds the [first, last) entries of a TTree
+// that should be processed together.
+typedef std::pair<Long64_t, Long64_t> Entry_Range;
+
+// job_ranges is the number of ranges the entries of a job are split
+// into for the threads to share. It doesn't depend on the number of
+// threads, so every range is filled into its own histograms the same
+// way no matter how many threads run.
+const int job_ranges = 64;
+
+// cluster_starts returns the first entry of every TTree cluster
+// inside (first, last). For a TChain, the clusters of every file
+// are used and the first entry of each file is also included.
+std::vector<Long64_t> cluster_starts(TTree *tree, Long64_t first, Long64_t last) {
+    std::vector<Long64_t> starts;
+    auto chain = dynamic_cast<TChain *>(tree);
+    if (chain == nullptr) {
+        auto clusters = tree->GetClusterIterator(first);
+        Long64_t start;
+        while ((start = clusters()) < last) {
+            if (start > first) {
+                starts.push_back(start);
+            }
+        }
+        return starts;
+    }
+
+    chain->GetEntries();  // makes sure all offsets are known
+    auto offsets = chain->GetTreeOffset();
+    for (auto i = 0; i < chain->GetNtrees(); i++) {
+        auto file_first = std::max(first, offsets[i]);
+        auto file_last = std::min(last, offsets[i + 1]);
+        if (file_first >= file_last) {
+            continue;
+        }
+        chain->LoadTree(file_first);
+        auto clusters = chain->GetTree()->GetClusterIterator(file_first - offsets[i]);
+        Long64_t start;
+        while ((start = clusters() + offsets[i]) < file_last) {
+            if (start > first) {
+                starts.push_back(start);
+            }
+        }
+    }
+    return starts;
+}
+
+// cluster_ranges divides the entries [first, last) into at most
+// nranges contiguous ranges of roughly equal size. Every boundary
+// between two ranges is placed at the start of a TTree cluster so
+// that no basket has to be read and decompressed by more than one
+// range. A tree with fewer clusters than nranges gives fewer ranges.
+std::vector<Entry_Range> cluster_ranges(TTree *tree, Long64_t first, Long64_t last, int nranges) {
+    std::vector<Entry_Range> ranges;
+    auto nevts = last - first;
+    if (nevts <= 0) {
+        return ranges;
+    }
+    if (nranges < 1) {
+        nranges = 1;
+    }
+
+    auto starts = cluster_starts(tree, first, last);
+
+    // close a range as soon as it reaches its share of the entries
+    auto range_start = first;
+    auto iboundary = 1;
+    for (auto boundary : starts) {
+        if (boundary - first >= nevts * iboundary / nranges) {
+            ranges.push_back(std::make_pair(range_start, boundary));
+            range_start = boundary;
+            while (boundary - first >= nevts * iboundary / nranges) {
+                iboundary++;
+            }
+        }
+    }
+    ranges.push_back(std::make_pair(range_start, last));
+    return ranges;
+}
+
+// job_range returns the entries processed by a single job. The
+// entries [first, last) are split into nchunks cluster-aligned chunks
+// and chunk ichunk is returned. A negative last means the end of the
+// tree. When the tree has too few clusters to give chunk ichunk, an
+// empty range is returned.
+Entry_Range job_range(TTree *tree, Long64_t first, Long64_t last, int nchunks, int ichunk) {
+    if (last < 0 || last > tree->GetEntries()) {
+        last = tree->GetEntries();
+    }
+    auto chunks = cluster_ranges(tree, first, last, nchunks);
+    if (ichunk < 0 || ichunk >= static_cast<int>(chunks.size())) {
+        return std::make_pair(last, last);
+    }
+    return chunks.at(ichunk);
+}
+
+// File_Stats holds the number of entries read from a
+// single file and the time spent processing them.
+struct File_Stats {
+    Long64_t entries;
+    double seconds;
+};
+
+// overlapping_ranges returns the parts of the sorted, non-overlapping
+// selected ranges that fall inside range. It is used to process only
+// the selected entries (e.g. certified lumi blocks) of a range.
+std::vector<Entry_Range> overlapping_ranges(const std::vector<Entry_Range> &selected, const Entry_Range &range) {
+    std::vector<Entry_Range> overlaps;
+    auto it = std::upper_bound(selected.begin(), selected.end(), range.first,
+                               [](Long64_t entry, const Entry_Range &other) { return entry < other.second; });
+    for (; it != selected.end() && it->first < range.second; ++it) {
+        overlaps.push_back(std::make_pair(std::max(it->first, range.first), std::min(it->second, range.second)));
+    }
+    return overlaps;
+}
+
+// intersect_ranges returns the entries found in both lists of sorted,
+// non-overlapping ranges, e.g. the certified entries that also fired
+// the trigger.
+std::vector<Entry_Range> intersect_ranges(const std::vector<Entry_Range> &ranges, const std::vector<Entry_Range> &other) {
+    std::vector<Entry_Range> both;
+    for (auto &range : other) {
+        auto overlaps = overlapping_ranges(ranges, range);
+        both.insert(both.end(), overlaps.begin(), overlaps.end());
+    }
+    return both;
+}
+
+// File_Monitor follows a Worker through the files of a TChain
+// (a plain TTree counts as a single file). Next must be called
+// after every LoadTree and Pause at the end of every entry range,
+// so the time spent in each file can be measured.
+class File_Monitor {
+   public:
+    explicit File_Monitor(TTree *_tree) : tree(_tree), current(-1) {}
+    bool Next();
+    void Pause();
+
+    // getters
+    const std::map<int, File_Stats> &getStats() { return stats; }
+
+   private:
+    TTree *tree;
+    int current;
+    std::chrono::steady_clock::time_point start;
+    std::map<int, File_Stats> stats;  // keyed by TTree::GetTreeNumber
+};
+
+// Next counts the entry just loaded. Returns true if the entry
+// is in a different file than the previous one (or is the first
+// entry of a range), meaning per-file information must be updated.
+bool File_Monitor::Next() {
+    auto number = tree->GetTreeNumber();
+    auto new_file = number != current;
+    if (new_file) {
+        Pause();
+        current = number;
+        start = std::chrono::steady_clock::now();
+    }
+    stats[current].entries++;
+    return new_file;
+}
+
+// Pause stops the clock for the current file.
+void File_Monitor::Pause() {
+    if (current < 0) {
+        return;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    stats[current].seconds += elapsed.count();
+    current = -1;
+}
+
+// Range_Queue hands out entry ranges to worker threads. Each
+// range is given to exactly one thread and threads that finish
+// early simply take the next range.
+class Range_Queue {
+   public:
+    explicit Range_Queue(std::vector<Entry_Range> _ranges) : next(0), ranges(_ranges) {}
+    bool Next(Entry_Range *, size_t *index = nullptr);
+    size_t size() { return ranges.size(); }
+
+   private:
+    std::atomic<size_t> next;
+    std::vector<Entry_Range> ranges;
+};
+
+// Next stores the next unprocessed range in range and, if requested,
+// its position in the queue in index. Returns false once all ranges
+// have been handed out.
+bool Range_Queue::Next(Entry_Range *range, size_t *index) {
+    auto idx = next++;
+    if (idx >= ranges.size()) {
+        return false;
+    }
+    *range = ranges.at(idx);
+    if (index != nullptr) {
+        *index = idx;
+    }
+    return true;
+}
+
+// run_threads calls work(ithread) from nthreads threads and waits
+// for all of them to finish. With a single thread, work is called
+// directly without starting a new thread. Every thread must open its
+// own TFile and construct its own factories since neither can be
+// shared between threads, and ROOT::EnableThreadSafety must be called
+// before the first file is opened. An exception thrown by work is
+// caught in its thread and, once all threads are done, the first one
+// is rethrown, the same as with a single thread.
+void run_threads(int nthreads, std::function<void(int)> work) {
+    if (nthreads <= 1) {
+        work(0);
+        return;
+    }
+    std::vector<std::exception_ptr> errors(nthreads);
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < nthreads; i++) {
+        threads.push_back(std::thread([&work, &errors, i]() {
+            try {
+                work(i);
+            } catch (...) {
+                errors.at(i) = std::current_exception();
+            }
+        }));
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (auto &error : errors) {
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif  // INTERFACE_EVENT_LOOP_H_
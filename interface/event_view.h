@@ -0,0 +1,198 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_EVENT_VIEW_H_
+#define INTERFACE_EVENT_VIEW_H_
+
+#include <map>
+#include <vector>
+#include "./boosted_factory.h"
+#include "./column_cache.h"
+#include "./electron_factory.h"
+#include "./event_factory.h"
+#include "./event_loop.h"
+#include "./gen_factory.h"
+#include "./jets_factory.h"
+#include "./muon_factory.h"
+#include "./pileup.h"
+#include "TTree.h"
+
+// Event_View owns one set of factories bound to a TTree and shares
+// the current event between several selections. The event-level
+// branches and the event weight are read by Next. Every other factory
+// is only read and run the first time a selection asks for it in an
+// event, so the objects are decompressed at most once per event no
+// matter how many selections use them, and not at all if every
+// selection rejected the event before needing them.
+//
+// With a Column_Cache_Reader set, Next fills all factories from the
+// cache instead of the TTree and the factories aren't run at all. The
+// generator-level particles aren't cached and are always read from
+// the TTree.
+//
+// Like the factories, an Event_View belongs to a single thread.
+class Event_View {
+   public:
+    Event_View(TTree *, bool, const std::vector<Double_t> &, const std::vector<Pileup_Table> &);
+    void Next(Long64_t);
+    void Pause() { monitor.Pause(); }
+    void Write_Cache(Column_Cache_Writer *);
+    void Read_Cache(Column_Cache_Reader *reader) { cache = reader; }  // nullptr to read the TTree again
+    Event_Factory &getEvent() { return event; }
+    Jets_Factory &getJets();
+    Muon_Factory &getMuons();
+    Electron_Factory &getElectrons();
+    Boosted_Factory &getTaus();
+    Gen_Factory &getGens();
+
+    // getters
+    Double_t getWeight() const { return init_weight * pu.nominal; }  // normalization and nominal pileup weight
+    Double_t getNormalization() const { return init_weight; }
+    const Pileup_Weights &getPileup() const { return pu; }
+    Long64_t getBytesRead() const { return bytes_read; }
+    const std::map<int, File_Stats> &getFileStats() { return monitor.getStats(); }
+
+   private:
+    template <typename F>
+    void Visit_Factories(F *);
+
+    TTree *tree;
+    File_Monitor monitor;
+    std::vector<Double_t> weights;     // normalization of each input file
+    std::vector<Pileup_Table> pileup;  // pileup weights of each input file
+    const Pileup_Table *pu_table;      // table of the current file
+    Double_t init_weight;
+    Pileup_Weights pu;
+    Column_Cache_Reader *cache;
+    Long64_t entry, bytes_read;
+    bool jets_loaded, muons_loaded, electrons_loaded, taus_loaded, gens_loaded;
+    Event_Factory event;
+    Jets_Factory jet_factory;
+    Muon_Factory muon_factory;
+    Electron_Factory electron_factory;
+    Boosted_Factory boost_factory;
+    Gen_Factory gen_factory;
+};
+
+// Event_View constructs all factories from the provided TTree. All
+// branches should already be disabled so only the branches bound by
+// the factories are read.
+Event_View::Event_View(TTree *_tree, bool is_data, const std::vector<Double_t> &_weights, const std::vector<Pileup_Table> &_pileup)
+    : tree(_tree),
+      monitor(_tree),
+      weights(_weights),
+      pileup(_pileup),
+      pu_table(nullptr),
+      init_weight(1.),
+      pu(Pileup_Weights{1., 1., 1.}),
+      cache(nullptr),
+      entry(0),
+      bytes_read(0),
+      jets_loaded(false),
+      muons_loaded(false),
+      electrons_loaded(false),
+      taus_loaded(false),
+      gens_loaded(false),
+      event(_tree, is_data),
+      jet_factory(_tree, is_data),
+      muon_factory(_tree),
+      electron_factory(_tree),
+      boost_factory(_tree),
+      gen_factory(_tree, is_data) {}
+
+// Next moves to entry i of the tree. The event-level branches are
+// read right away, the other factories once they are asked for. With a
+// cache, only the position in the TChain is updated (to find the file
+// weights) and no branch is read.
+void Event_View::Next(Long64_t i) {
+    entry = tree->LoadTree(i);
+    if (monitor.Next()) {  // switched to a new file
+        init_weight = weights.at(tree->GetTreeNumber());
+        pu_table = &pileup.at(tree->GetTreeNumber());
+    }
+    if (cache != nullptr) {
+        cache->Seek(i);
+        Visit_Factories(cache);
+        jets_loaded = muons_loaded = electrons_loaded = taus_loaded = true;
+    } else {
+        jets_loaded = muons_loaded = electrons_loaded = taus_loaded = false;
+        bytes_read += event.Load(entry);
+        event.Run_Factory();
+    }
+    gens_loaded = false;
+    pu = pu_table->Get(event.getTruePU());  // nominal, up and down at once
+}
+
+// Write_Cache runs every factory for the current event, even those
+// no selection asked for, and adds the results to the cache.
+void Event_View::Write_Cache(Column_Cache_Writer *writer) {
+    getJets();
+    getMuons();
+    getElectrons();
+    getTaus();
+    writer->Next();
+    Visit_Factories(writer);
+}
+
+// Visit_Factories hands every factory to a Column_Cache_Writer or
+// Column_Cache_Reader. The order must never change between events.
+template <typename F>
+void Event_View::Visit_Factories(F *visitor) {
+    event.Cache(visitor);
+    jet_factory.Cache(visitor);
+    muon_factory.Cache(visitor);
+    electron_factory.Cache(visitor);
+    boost_factory.Cache(visitor);
+}
+
+// getJets returns the jets of the current event.
+Jets_Factory &Event_View::getJets() {
+    if (!jets_loaded) {
+        bytes_read += jet_factory.Load(entry);
+        jet_factory.Run_Factory();
+        jets_loaded = true;
+    }
+    return jet_factory;
+}
+
+// getMuons returns the muons of the current event.
+Muon_Factory &Event_View::getMuons() {
+    if (!muons_loaded) {
+        bytes_read += muon_factory.Load(entry);
+        muon_factory.Run_Factory();
+        muons_loaded = true;
+    }
+    return muon_factory;
+}
+
+// getElectrons returns the electrons of the current event.
+Electron_Factory &Event_View::getElectrons() {
+    if (!electrons_loaded) {
+        bytes_read += electron_factory.Load(entry);
+        electron_factory.Run_Factory();
+        electrons_loaded = true;
+    }
+    return electron_factory;
+}
+
+// getTaus returns the boosted taus of the current event.
+Boosted_Factory &Event_View::getTaus() {
+    if (!taus_loaded) {
+        bytes_read += boost_factory.Load(entry);
+        boost_factory.Run_Factory();
+        taus_loaded = true;
+    }
+    return boost_factory;
+}
+
+// getGens returns the generator-level particles of the current event.
+// They are empty in data.
+Gen_Factory &Event_View::getGens() {
+    if (!gens_loaded) {
+        bytes_read += gen_factory.Load(entry);
+        gen_factory.Run_Factory();
+        gens_loaded = true;
+    }
+    return gen_factory;
+}
+
+#endif  // INTERFACE_EVENT_VIEW_H_
@@ -4,76 +4,176 @@
 #define INTERFACE_GEN_FACTORY_H_
 
 #include <algorithm>
+#include <cstdlib>
 #include <memory>
+#include <string>
 #include <vector>
-#include "TLorentzVector.h"
+#include "./branch_registry.h"
+#include "./collection.h"
+#include "./p4.h"
 #include "TTree.h"
 
 class Gen;  // Gen combines all generator-level information
-typedef std::vector<Gen> VGen;
+typedef Collection<Gen> VGen;
 
-// Gen combines all generator-level information along with
-// creating the gen 4-vector. Helper functions are provided
-// to access properties of the gens. These properties cannot
-// be updated.
+// Gen gives access to all generator-level information along with
+// creating the gen 4-vector. The information is stored in the
+// Columns of a VGen and the Gen only points to its row, so it is
+// cheap to copy. Helper functions are provided to access
+// properties of the gens. These properties cannot be updated.
 class Gen {
-    friend class Gen_Factory;  // Gen_Factory constructs individual Gens
+   public:
+    // Columns holds every variable for all gens in the event.
+    struct Columns {
+        std::vector<Float_t> pt, eta, phi, mass, MomPt, MomEta, MomPhi, MomMass;
+        std::vector<Int_t> PID, GMomPID, MomPID, Parentage, Status;
+        void clear();
+    };
+
+    Gen() : columns(nullptr), row(0) {}
+    Gen(const Columns *_columns, unsigned _row) : columns(_columns), row(_row) {}
+
+    // getters
+    Int_t getPID() const { return columns->PID[row]; }
+    Int_t getMomPID() const { return columns->MomPID[row]; }
+    Int_t getGMomPID() const { return columns->GMomPID[row]; }
+    Int_t getStatus() const { return columns->Status[row]; }
+    Int_t getParentage() const { return columns->Parentage[row]; }
+    PtEtaPhiM getP4() const { return PtEtaPhiM(getPt(), getEta(), getPhi(), getMass()); }
+    Float_t getPt() const { return columns->pt[row]; }
+    Float_t getEta() const { return columns->eta[row]; }
+    Float_t getPhi() const { return columns->phi[row]; }
+    Float_t getMass() const { return columns->mass[row]; }
+    PtEtaPhiM getMomP4() const { return PtEtaPhiM(getMomPt(), getMomEta(), getMomPhi(), getMomMass()); }
+    Float_t getMomPt() const { return columns->MomPt[row]; }
+    Float_t getMomEta() const { return columns->MomEta[row]; }
+    Float_t getMomPhi() const { return columns->MomPhi[row]; }
+    Float_t getMomMass() const { return columns->MomMass[row]; }
+
+   private:
+    const Columns *columns;
+    unsigned row;
+};
+
+// enum for the final state of a tau decay
+enum tau_decay {
+    tau_to_electron,
+    tau_to_muon,
+    tau_to_hadrons
+};
+
+// max_graph_pid bounds the |PID| of particles that can be looked up by
+// PID. It covers all quarks, leptons and bosons.
+const int max_graph_pid = 64;
+
+// Gen_Rows is a range of rows of the gen columns, usable in a
+// range-based for loop.
+struct Gen_Rows {
+    const unsigned *first, *last;
+    const unsigned *begin() const { return first; }
+    const unsigned *end() const { return last; }
+    unsigned size() const { return last - first; }
+    bool empty() const { return first == last; }
+};
 
+// Gen_Tau is the last copy of a generator-level tau and its decay.
+// visible is the tau minus its stored neutrinos.
+struct Gen_Tau {
+    unsigned row;
+    tau_decay decay;
+    PtEtaPhiM visible;
+};
+
+// Gen_Graph links the gen particles of an event into a decay graph.
+// The ggNtuples don't store mother indices, only the PID and
+// kinematics of the mother, so a mother is found by looking up the
+// last particle stored before it with the same PID, pT, eta and phi.
+// Mothers that weren't stored get -1. The daughters of every particle and the
+// particles of every |PID| are kept as flat arrays with offsets, so all
+// queries are O(1) once the graph is built.
+//
+// Rows refer to the gen columns in TTree order (Collection::getColumns),
+// not to the pT order. All arrays keep their capacity between events,
+// so no memory is allocated once the largest event has been seen.
+class Gen_Graph {
    public:
-    Gen(Float_t _pt, Float_t _eta, Float_t _phi, Float_t _mass) { this->p4.SetPtEtaPhiM(_pt, _eta, _phi, _mass); }
-    Gen() { this->p4.SetPtEtaPhiM(0, 0, 0, 0); }
+    Gen_Graph() : columns(nullptr), pid_offsets(max_graph_pid + 1, 0), leading_last_copy(max_graph_pid, -1), tau_decays{0, 0, 0} {}
+    void Build(const Gen::Columns *);
 
     // getters
-    Int_t getPID() const { return PID; }
-    Int_t getMomPID() const { return MomPID; }
-    Int_t getGMomPID() const { return GMomPID; }
-    Int_t getStatus() const { return Status; }
-    Int_t getParentage() const { return Parentage; }
-    TLorentzVector getP4() { return p4; }
-    Float_t getPt() { return p4.Pt(); }
-    Float_t getEta() { return p4.Eta(); }
-    Float_t getPhi() { return p4.Phi(); }
-    Float_t getMass() { return p4.M(); }
-    TLorentzVector getMomP4() { return MomP4; }
-    Float_t getMomPt() const { return MomP4.Pt(); }
-    Float_t getMomEta() const { return MomP4.Eta(); }
-    Float_t getMomPhi() const { return MomP4.Phi(); }
-    Float_t getMomMass() const { return MomP4.M(); }
-
-    // setters
-    void setMomP4(float _pt, float _eta, float _phi, float _mass) { MomP4.SetPtEtaPhiM(_pt, _eta, _phi, _mass); }
-    void setP4WithEnergy(float _pt, float _eta, float _phi, float _energy) { p4.SetPtEtaPhiE(_pt, _eta, _phi, _energy); }
+    unsigned size() const { return mothers.size(); }
+    Gen at(unsigned row) const { return Gen(columns, row); }
+    int getMother(unsigned row) const { return mothers[row]; }  // -1 if the mother isn't stored
+    Gen_Rows getDaughters(unsigned row) const { return Rows(daughters, daughter_offsets, row); }
+    Gen_Rows getParticles(int pid) const {  // all particles with the same |PID|
+        auto apid = std::abs(pid);
+        return apid < max_graph_pid ? Rows(pid_rows, pid_offsets, apid) : Gen_Rows{nullptr, nullptr};
+    }
+    bool isLastCopy(unsigned row) const { return last_copy[row]; }
+    int getLastCopy(int pid) const {  // highest pT last copy, e.g. the Z after radiation. -1 if there is none
+        auto apid = std::abs(pid);
+        return apid < max_graph_pid ? leading_last_copy[apid] : -1;
+    }
+    const std::vector<Gen_Tau> &getTaus() const { return taus; }  // last copies of all taus
+    unsigned getNTauDecays(tau_decay decay) const { return tau_decays[decay]; }
 
    private:
-    // these should never be modified once read from the TTree
-    TLorentzVector p4, MomP4;
-    Int_t PID, GMomPID, MomPID, Parentage, Status;
+    // Key sorts the particles for the mother lookup.
+    struct Key {
+        Int_t pid;
+        Float_t pt;
+        unsigned row;
+        bool operator<(const Key &other) const {
+            return pid < other.pid || (pid == other.pid && (pt < other.pt || (pt == other.pt && row < other.row)));
+        }
+    };
+    Gen_Rows Rows(const std::vector<unsigned> &rows, const std::vector<unsigned> &offsets, unsigned i) const {
+        auto data = rows.data();
+        return Gen_Rows{data + offsets[i], data + offsets[i + 1]};
+    }
+    int Find_Mother(unsigned) const;
+
+    const Gen::Columns *columns;
+    std::vector<Key> keys;
+    std::vector<int> mothers;
+    std::vector<unsigned> daughters, daughter_offsets;  // daughters of row i are daughters[daughter_offsets[i]] up to daughters[daughter_offsets[i + 1]]
+    std::vector<unsigned> pid_rows, pid_offsets;        // same for the particles of every |PID|
+    std::vector<unsigned> fill;                         // scratch space while building the arrays
+    std::vector<bool> last_copy;
+    std::vector<int> leading_last_copy;  // indexed by |PID|
+    std::vector<Gen_Tau> taus;
+    unsigned tau_decays[3];
 };
 
 // Gen_Factory reads from the TTree and constructs
 // individual Gen objects. The Gen_Factory holds the
-// list of gens, but can provided a shared_ptr to the
-// list.
+// list of gens. The list is handed out by
+// reference and is only valid until the next Run_Factory.
 class Gen_Factory {
    public:
     Gen_Factory(TTree *, bool);
     void Run_Factory();
+    Int_t Load(Long64_t entry) { return registry.Load(entry); }  // read only this factory's branches
 
     // getters
+    const std::vector<std::string> &getBranches() { return registry.getNames(); }  // branches read by this factory
     Int_t getNTotalGen() { return nMC; }      // nMC directly from TTree
     Int_t getNGoodGen() { return nGoodGen; }  // nMC passing preselection
     Float_t getMET() { return genMET; }
     Float_t getMetPhi() { return genMETPhi; }
-    TLorentzVector getMETP4() { return MET_p4; }
-    std::shared_ptr<VGen> getGens() { return std::make_shared<VGen>(gen_particles); }
-    std::shared_ptr<VGen> getGenJets() { return std::make_shared<VGen>(gen_jets); }
+    PtEtaPhiM getMETP4() { return MET_p4; }
+    const VGen &getGens() const { return gen_particles; }
+    const VGen &getGenJets() const { return gen_jets; }
+    const Gen_Graph &getGraph() const { return graph; }  // decay graph of getGens().getColumns()
 
    private:
+    Branch_Registry registry;
     Bool_t is_data;
     Int_t nMC, nGoodGen;
     Float_t genMET, genMETPhi;
     VGen gen_particles, gen_jets;
-    TLorentzVector MET_p4;
+    Gen_Graph graph;
+    PtEtaPhiM MET_p4;
     std::vector<Int_t> *mcPID, *mcGMomPID, *mcMomPID, *mcParentage, *mcStatus;
     std::vector<Float_t> *mcPt, *mcMass, *mcEta, *mcPhi, *mcMomPt, *mcMomMass, *mcMomEta, *mcMomPhi;
     std::vector<Float_t> *jetGenJetPt, *jetGenJetEta, *jetGenJetPhi, *jetGenJetEn;
@@ -81,7 +181,8 @@ class Gen_Factory {
 
 // Set all branch addresses when constructing a Gen_Factory.
 Gen_Factory::Gen_Factory(TTree *tree, bool is_data_)
-    : is_data(is_data_),
+    : registry(tree),
+      is_data(is_data_),
       mcPID(nullptr),
       mcPt(nullptr),
       mcMass(nullptr),
@@ -100,71 +201,230 @@ Gen_Factory::Gen_Factory(TTree *tree, bool is_data_)
       jetGenJetPhi(nullptr),
       jetGenJetEn(nullptr) {
     if (!is_data) {
-        tree->SetBranchAddress("nMC", &nMC);
-        tree->SetBranchAddress("mcPID", &mcPID);
-        tree->SetBranchAddress("mcPt", &mcPt);
-        tree->SetBranchAddress("mcMass", &mcMass);
-        tree->SetBranchAddress("mcEta", &mcEta);
-        tree->SetBranchAddress("mcPhi", &mcPhi);
-        tree->SetBranchAddress("mcGMomPID", &mcGMomPID);
-        tree->SetBranchAddress("mcMomPID", &mcMomPID);
-        tree->SetBranchAddress("mcMomPt", &mcMomPt);
-        tree->SetBranchAddress("mcMomMass", &mcMomMass);
-        tree->SetBranchAddress("mcMomEta", &mcMomEta);
-        tree->SetBranchAddress("mcMomPhi", &mcMomPhi);
-        tree->SetBranchAddress("mcParentage", &mcParentage);
-        tree->SetBranchAddress("mcStatus", &mcStatus);
+        registry.Bind("nMC", &nMC);
+        registry.Bind("mcPID", &mcPID);
+        registry.Bind("mcPt", &mcPt);
+        registry.Bind("mcMass", &mcMass);
+        registry.Bind("mcEta", &mcEta);
+        registry.Bind("mcPhi", &mcPhi);
+        registry.Bind("mcGMomPID", &mcGMomPID);
+        registry.Bind("mcMomPID", &mcMomPID);
+        registry.Bind("mcMomPt", &mcMomPt);
+        registry.Bind("mcMomMass", &mcMomMass);
+        registry.Bind("mcMomEta", &mcMomEta);
+        registry.Bind("mcMomPhi", &mcMomPhi);
+        registry.Bind("mcParentage", &mcParentage);
+        registry.Bind("mcStatus", &mcStatus);
 
         // gen jets
-        tree->SetBranchAddress("jetGenJetPt", &jetGenJetPt);
-        tree->SetBranchAddress("jetGenJetEta", &jetGenJetEta);
-        tree->SetBranchAddress("jetGenJetPhi", &jetGenJetPhi);
-        tree->SetBranchAddress("jetGenJetEn", &jetGenJetEn);
+        registry.Bind("jetGenJetPt", &jetGenJetPt);
+        registry.Bind("jetGenJetEta", &jetGenJetEta);
+        registry.Bind("jetGenJetPhi", &jetGenJetPhi);
+        registry.Bind("jetGenJetEn", &jetGenJetEn);
 
         // gen MET
-        tree->SetBranchAddress("genMET", &genMET);
-        tree->SetBranchAddress("genMETPhi", &genMETPhi);
+        registry.Bind("genMET", &genMET);
+        registry.Bind("genMETPhi", &genMETPhi);
     }
 }
 
-// Called once per event to construct the Gens. A basic
-// preselection is applied to all gens. All Gens passing
-// preselection are sorted by pT and stored.
+// Called once per event to fill the gen columns. A basic
+// preselection is applied to all gens. All gens passing
+// preselection are stored and ordered by pT. The decay graph
+// is built from the gens in TTree order.
 void Gen_Factory::Run_Factory() {
     if (is_data) {  // generator-information isn't avaiable in data
         return;
     }
     // get gen quarks (mc*)
-    gen_particles.clear();
+    auto &columns = gen_particles.Reset();
     for (auto i = 0; i < nMC; i++) {
-        auto gen = Gen(mcPt->at(i), mcEta->at(i), mcPhi->at(i), mcMass->at(i));
-        gen.setMomP4(mcMomPt->at(i), mcMomEta->at(i), mcMomPhi->at(i), mcMomMass->at(i));
-        gen.PID = mcPID->at(i);
-        gen.GMomPID = mcGMomPID->at(i);
-        gen.MomPID = mcMomPID->at(i);
-        gen.Parentage = mcParentage->at(i);
-        gen.Status = mcStatus->at(i);
-        gen_particles.push_back(gen);
-    }
-
-    // get gen jets (jetGenJet*)
-    gen_jets.clear();
+        columns.pt.push_back(mcPt->at(i));
+        columns.eta.push_back(mcEta->at(i));
+        columns.phi.push_back(mcPhi->at(i));
+        columns.mass.push_back(mcMass->at(i));
+        columns.MomPt.push_back(mcMomPt->at(i));
+        columns.MomEta.push_back(mcMomEta->at(i));
+        columns.MomPhi.push_back(mcMomPhi->at(i));
+        columns.MomMass.push_back(mcMomMass->at(i));
+        columns.PID.push_back(mcPID->at(i));
+        columns.GMomPID.push_back(mcGMomPID->at(i));
+        columns.MomPID.push_back(mcMomPID->at(i));
+        columns.Parentage.push_back(mcParentage->at(i));
+        columns.Status.push_back(mcStatus->at(i));
+    }
+
+    // get gen jets (jetGenJet*). Gen jets have no mother or
+    // particle ID so those are set to 0.
+    auto &jet_columns = gen_jets.Reset();
     for (auto i = 0; i < jetGenJetPt->size(); i++) {
         if (jetGenJetPt->at(i) == -999) {
             continue;
         }
-        auto temp = Gen();
-        temp.setP4WithEnergy(jetGenJetPt->at(i), jetGenJetEta->at(i), jetGenJetPhi->at(i), jetGenJetEn->at(i));
-        gen_jets.push_back(temp);
+        auto jet = PtEtaPhiM::FromPtEtaPhiE(jetGenJetPt->at(i), jetGenJetEta->at(i), jetGenJetPhi->at(i), jetGenJetEn->at(i));
+        jet_columns.pt.push_back(jet.Pt());
+        jet_columns.eta.push_back(jet.Eta());
+        jet_columns.phi.push_back(jet.Phi());
+        jet_columns.mass.push_back(jet.M());
+        for (auto column : {&jet_columns.MomPt, &jet_columns.MomEta, &jet_columns.MomPhi, &jet_columns.MomMass}) {
+            column->push_back(0);
+        }
+        for (auto column : {&jet_columns.PID, &jet_columns.GMomPID, &jet_columns.MomPID, &jet_columns.Parentage, &jet_columns.Status}) {
+            column->push_back(0);
+        }
     }
 
     // sort by pT
-    std::sort(gen_jets.begin(), gen_jets.end(), [](Gen &p1, Gen &p2) -> bool { return p1.getPt() > p2.getPt(); });
-    std::sort(gen_particles.begin(), gen_particles.end(), [](Gen &p1, Gen &p2) -> bool { return p1.getPt() > p2.getPt(); });
+    gen_jets.Sort();
+    gen_particles.Sort();
+    graph.Build(&gen_particles.getColumns());
 
     // set generator-level information
     nGoodGen = gen_particles.size();
-    MET_p4.SetPtEtaPhiM(genMET, 0, genMETPhi, 0);
+    MET_p4 = PtEtaPhiM(genMET, 0, genMETPhi, 0);
+}
+
+// Build links all particles of the current event. Must be called
+// again whenever the columns change.
+void Gen_Graph::Build(const Gen::Columns *_columns) {
+    columns = _columns;
+    auto &PID = columns->PID;
+    auto &MomPID = columns->MomPID;
+    auto nparticles = PID.size();
+
+    // mothers
+    keys.clear();
+    for (unsigned row = 0; row < nparticles; row++) {
+        keys.push_back(Key{PID[row], columns->pt[row], row});
+    }
+    std::sort(keys.begin(), keys.end());
+    mothers.resize(nparticles);
+    for (unsigned row = 0; row < nparticles; row++) {
+        mothers[row] = Find_Mother(row);
+    }
+
+    // daughters, as a counting sort of the rows by their mother
+    daughter_offsets.assign(nparticles + 1, 0);
+    for (auto mother : mothers) {
+        if (mother >= 0) {
+            daughter_offsets[mother + 1]++;
+        }
+    }
+    for (unsigned row = 0; row < nparticles; row++) {
+        daughter_offsets[row + 1] += daughter_offsets[row];
+    }
+    fill.assign(daughter_offsets.begin(), daughter_offsets.end() - 1);
+    daughters.resize(daughter_offsets.back());
+    for (unsigned row = 0; row < nparticles; row++) {
+        if (mothers[row] >= 0) {
+            daughters[fill[mothers[row]]++] = row;
+        }
+    }
+
+    // particles by |PID|, the same way
+    pid_offsets.assign(max_graph_pid + 1, 0);
+    for (auto pid : PID) {
+        if (std::abs(pid) < max_graph_pid) {
+            pid_offsets[std::abs(pid) + 1]++;
+        }
+    }
+    for (auto pid = 0; pid < max_graph_pid; pid++) {
+        pid_offsets[pid + 1] += pid_offsets[pid];
+    }
+    fill.assign(pid_offsets.begin(), pid_offsets.end() - 1);
+    pid_rows.resize(pid_offsets.back());
+    for (unsigned row = 0; row < nparticles; row++) {
+        if (std::abs(PID[row]) < max_graph_pid) {
+            pid_rows[fill[std::abs(PID[row])]++] = row;
+        }
+    }
+
+    // last copies have no daughter with the same PID
+    last_copy.assign(nparticles, true);
+    for (unsigned row = 0; row < nparticles; row++) {
+        if (mothers[row] >= 0 && PID[mothers[row]] == PID[row]) {
+            last_copy[mothers[row]] = false;
+        }
+    }
+    leading_last_copy.assign(max_graph_pid, -1);
+    for (unsigned row = 0; row < nparticles; row++) {
+        auto apid = std::abs(PID[row]);
+        if (last_copy[row] && apid < max_graph_pid &&
+            (leading_last_copy[apid] < 0 || columns->pt[row] > columns->pt[leading_last_copy[apid]])) {
+            leading_last_copy[apid] = row;
+        }
+    }
+
+    // tau decays. Leptons are counted by the PID of their mother, so
+    // they are found even if the tau itself wasn't stored.
+    tau_decays[tau_to_electron] = tau_decays[tau_to_muon] = tau_decays[tau_to_hadrons] = 0;
+    for (unsigned row = 0; row < nparticles; row++) {
+        if (std::abs(MomPID[row]) == 15 && std::abs(PID[row]) == 11) {
+            tau_decays[tau_to_electron]++;
+        } else if (std::abs(MomPID[row]) == 15 && std::abs(PID[row]) == 13) {
+            tau_decays[tau_to_muon]++;
+        }
+    }
+    taus.clear();
+    for (auto row : getParticles(15)) {
+        if (!last_copy[row]) {
+            continue;
+        }
+        auto p4 = at(row).getP4();
+        auto px(p4.Px()), py(p4.Py()), pz(p4.Pz()), e(p4.E());
+        Gen_Tau tau{row, tau_to_hadrons, p4};
+        for (auto daughter : getDaughters(row)) {
+            auto apid = std::abs(PID[daughter]);
+            if (apid == 11) {
+                tau.decay = tau_to_electron;
+            } else if (apid == 13) {
+                tau.decay = tau_to_muon;
+            } else if (apid == 12 || apid == 14 || apid == 16) {
+                auto neutrino = at(daughter).getP4();
+                px -= neutrino.Px();
+                py -= neutrino.Py();
+                pz -= neutrino.Pz();
+                e -= neutrino.E();
+                tau.visible = PtEtaPhiM::FromPxPyPzE(px, py, pz, e);
+            }
+        }
+        if (tau.decay == tau_to_hadrons) {
+            tau_decays[tau_to_hadrons]++;
+        }
+        taus.push_back(tau);
+    }
+}
+
+// Find_Mother returns the row of the stored particle matching the
+// mother PID and kinematics of row, or -1. The values are copied from
+// the same object by the ntuplizer, so they are compared exactly.
+// Mothers are stored before their daughters, so the last match before
+// row is taken. Copies with identical kinematics then form a chain
+// ending in the last copy and can never point at each other.
+int Gen_Graph::Find_Mother(unsigned row) const {
+    Key key{columns->MomPID[row], columns->MomPt[row], row};
+    auto candidate = std::lower_bound(keys.begin(), keys.end(), key);  // first key at or after row
+    while (candidate != keys.begin()) {
+        --candidate;
+        if (candidate->pid != key.pid || candidate->pt != key.pt) {
+            break;
+        }
+        auto mother = candidate->row;
+        if (columns->eta[mother] == columns->MomEta[row] && columns->phi[mother] == columns->MomPhi[row]) {
+            return mother;
+        }
+    }
+    return -1;
+}
+
+// clear empties all columns while keeping their memory.
+void Gen::Columns::clear() {
+    for (auto column : {&pt, &eta, &phi, &mass, &MomPt, &MomEta, &MomPhi, &MomMass}) {
+        column->clear();
+    }
+    for (auto column : {&PID, &GMomPID, &MomPID, &Parentage, &Status}) {
+        column->clear();
+    }
 }
 
 #endif  // INTERFACE_GEN_FACTORY_H_
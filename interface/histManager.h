@@ -3,113 +3,460 @@
 #ifndef INTERFACE_HISTMANAGER_H_
 #define INTERFACE_HISTMANAGER_H_
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <initializer_list>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <vector>
+#include "./hist_buffer.h"
 #include "./json.hpp"
+#include "./regions.h"
 #include "TFile.h"
 #include "TH1F.h"
 #include "TH2F.h"
 
-// histManager holds a map of histograms and provides
+// histManager holds a set of histograms and provides
 // methods to fill them. Histograms are ready from the
 // provided json file which includes a histogram name
 // and corresponding binning. histManager also allows all
 // histograms to be written at one time.
+//
+// The histograms are kept in a Hist_Buffer until Write is called
+// and only then converted to TH1F/TH2F. For threaded running, every
+// range of entries is filled into its own buffer from Buffer() and
+// the buffers are added with Merge in the order of the ranges. The
+// output then doesn't depend on the number of threads.
 class histManager {
    public:
     explicit histManager(std::string);
-    ~histManager() {}
     void load_histograms(std::string);
-    void Fill(std::string, double, double);
-    void Fill2d(std::string, double, double, double);
-    void FillBin(std::string, int, double);
-    void FillPrevBins(std::string, double, double);
+    void Set_Fill_Buffer(unsigned);
+    Hist_Buffer Buffer() const { return Hist_Buffer(layout, fill_buffer); }
+    void Merge(Hist_Buffer *);
+    Hist_1D Get1D(const std::string &) const;
+    Hist_2D Get2D(const std::string &) const;
+    Hist_Eff GetEfficiency(const std::string &) const;
+    Hist_Combinations GetCombinations(const std::string &) const;
+    Region_Hists GetRegions(const std::vector<std::string> &, const std::vector<std::string> &, const std::string &systematic = "") const;
+    void Fill(Hist_1D hist, double var, double weight) { total.Fill(hist, var, weight); }
+    void Fill2d(Hist_2D hist, double var1, double var2, double weight) { total.Fill2d(hist, var1, var2, weight); }
+    void FillBin(Hist_1D hist, int bin, double weight) { total.FillBin(hist, bin, weight); }
+    void Fill(Hist_Eff hist, double var, bool passed, double weight) { total.Fill(hist, var, passed, weight); }
+    void Fill(const Hist_Combinations &hist, unsigned pattern, double weight) { total.Fill(hist, pattern, weight); }
+    void Fill(const Region_Hists &hists, unsigned region, std::initializer_list<double> values, double weight) {
+        total.Fill(hists, region, values, weight);
+    }
+    void Fill(std::string name, double var, double weight) { Fill(Get1D(name), var, weight); }
+    void Fill2d(std::string name, double var1, double var2, double weight) { Fill2d(Get2D(name), var1, var2, weight); }
+    void FillBin(std::string name, int bin, double weight) { FillBin(Get1D(name), bin, weight); }
     void Write();
 
-    // I'll make this public in case you want to handle
-    // things directly. (Don't make me regret it!)
-    std::map<std::string, TH1F*> hists_1d;
-    std::map<std::string, TH2F*> hists_2d;
+    // getters
+    const Region_Axes &getRegionAxes() const { return regions; }
+    const Hist_Buffer &getTotal() const { return total; }  // everything filled or merged so far
+
     std::shared_ptr<TFile> fout;
+
+   private:
+    void Book(const std::string &, const std::string &, const nlohmann::json &);
+    void Book_Hist(const std::string &, const std::string &, hist_type, const nlohmann::json &);
+    void Book_Directory(const std::string &, const nlohmann::json &);
+    void Book_Regions(const nlohmann::json &);
+    void Book_Combinations(const std::string &, const std::string &, const nlohmann::json &);
+    TH1 *Write_Hist(const Hist_Definition &, const Hist_Buffer &, double);
+    void Write_Efficiency(const Hist_Definition &, TH1 *, TH1 *);
+    void cd(const std::string &);
+
+    std::shared_ptr<Hist_Layout> layout;
+    Hist_Buffer total;
+    unsigned fill_buffer;  // fills collected per histogram by new buffers
+    std::map<std::string, unsigned> ids_1d, ids_2d;
+    Region_Axes regions;
 };
 
 // When constructing a histManager, create the output file
 // with the given name.
-histManager::histManager(std::string fname) : fout(std::make_shared<TFile>(fname.c_str(), "RECREATE")) {
-    fout->cd();
-    hists_1d = {};  // you can hardcode histograms here
-    hists_2d = {};  // you can hardcode histograms here
-}
+histManager::histManager(std::string fname)
+    : fout(std::make_shared<TFile>(fname.c_str(), "RECREATE")), layout(std::make_shared<Hist_Layout>()), total(layout), fill_buffer(0) {}
 
 // load_histograms reads the provided json config file
-// and then creates the requested histograms saving them
-// into either the 1D or 2D histogram map based on the number
-// of bins provided. If the number of bin arguments isn't correct,
-// a warning will be printed and that histogram will be skipped.
+// and then books the requested histograms as either 1D
+// or 2D histograms based on the number of bins provided.
+// If the number of bin arguments isn't correct, a warning
+// will be printed and that histogram will be skipped.
 void histManager::load_histograms(std::string json_file) {
     std::ifstream histograms(json_file);
     nlohmann::json histo_definitions;
     histograms >> histo_definitions;
     for (auto it = histo_definitions.begin(); it != histo_definitions.end(); it++) {
-        if (it.value().is_object()) {
-            fout->mkdir(it.key().c_str());
-            fout->cd(it.key().c_str());
-            for (auto jt = it.value().begin(); jt != it.value().end(); jt++) {
-                if (jt.value().size() == 3) {
-                    hists_1d[it.key() + "/" + jt.key()] =
-                        new TH1F(jt.key().c_str(), jt.key().c_str(), jt.value().at(0), jt.value().at(1), jt.value().at(2));
-                } else if (it.value().size() == 6) {
-                    hists_2d[it.key() + "/" + jt.key()] = new TH2F(jt.key().c_str(), jt.key().c_str(), jt.value().at(0), jt.value().at(1),
-                                                                   jt.value().at(2), jt.value().at(3), jt.value().at(4), jt.value().at(5));
-                } else {
-                    std::cout << "Histogram " << jt.key() << " has the wrong number of bins. Skipping." << std::endl;
-                }
-            }
-            fout->cd();
+        if (it.key() == "regions") {
+            Book_Regions(it.value());
+        } else if (it.value().is_object() && it.value().count("type") == 0) {
+            Book_Directory(it.key(), it.value());
         } else {
-            if (it.value().size() == 3) {
-                hists_1d[it.key()] = new TH1F(it.key().c_str(), it.key().c_str(), it.value().at(0), it.value().at(1), it.value().at(2));
-            } else if (it.value().size() == 6) {
-                hists_2d[it.key()] = new TH2F(it.key().c_str(), it.key().c_str(), it.value().at(0), it.value().at(1), it.value().at(2),
-                                              it.value().at(3), it.value().at(4), it.value().at(5));
-            } else {
-                std::cout << "Histogram " << it.key() << " has the wrong number of bins. Skipping." << std::endl;
-            }
+            Book("", it.key(), it.value());
         }
     }
+    total = Hist_Buffer(layout, fill_buffer);
 }
 
-// Fill fills the given 1D histogram with the provided variable and event weight.
-void histManager::Fill(std::string name, double var, double weight) { hists_1d.at(name)->Fill(var, weight); }
+// Set_Fill_Buffer turns on buffered filling with the given number of
+// fills per histogram for the histManager and all buffers created by
+// Buffer() afterwards (see Hist_Buffer). 0 turns it off.
+void histManager::Set_Fill_Buffer(unsigned size) {
+    fill_buffer = size;
+    total.Set_Fill_Buffer(size);
+}
 
-// Fill2d fills the given 2D histogram with the provided variable and event weight.
-void histManager::Fill2d(std::string name, double var1, double var2, double weight) { hists_2d.at(name)->Fill(var1, var2, weight); }
+// Merge flushes the buffer and adds its contents to the histograms.
+void histManager::Merge(Hist_Buffer *buffer) {
+    buffer->Flush();
+    total.Add(*buffer);
+}
 
-// FillBin fills the given 1D histogram at the requested bin with an event weight.
-void histManager::FillBin(std::string name, int bin, double weight) {
-    auto content = hists_1d.at(name)->GetBinContent(bin);
-    hists_1d.at(name)->SetBinContent(bin, content + weight);
+// Book adds a histogram to the layout. A plain histogram is given
+// by its binning, which is [nbins, low, high] for 1D histograms and
+// [nbins x, low x, high x, nbins y, low y, high y] for 2D histograms.
+// Other types are given as an object with the type and binning
+//     "lead_jet_eff": {"type": "cumulative", "bins": [100, 0, 1000]}
+// The types are
+//   - cumulative: every bin holds the sum of all fills at or above it.
+//     Each fill only adds to one bin and the sum is done in Write.
+//   - efficiency: booked as a numerator "name" and a denominator
+//     "name_den". Write also stores the ratio "name_eff" with binomial
+//     errors. Filled with Fill(Hist_Eff, var, passed, weight).
+//   - combinations: the OR of every combination of a list of trigger
+//     paths, see Book_Combinations. Given without "bins".
+// Both types with bins have to be 1D.
+void histManager::Book(const std::string &dir, const std::string &name, const nlohmann::json &definition) {
+    if (!definition.is_object()) {
+        Book_Hist(dir, name, plain_hist, definition);
+        return;
+    }
+
+    auto type = definition.at("type").get<std::string>();
+    if (type == "combinations") {
+        Book_Combinations(dir, name, definition.at("paths"));
+        return;
+    }
+    auto &binning = definition.at("bins");
+    if (binning.size() != 3) {
+        std::cout << "Histogram " << name << " of type " << type << " has to be 1D. Skipping." << std::endl;
+    } else if (type == "cumulative") {
+        Book_Hist(dir, name, cumulative_hist, binning);
+    } else if (type == "efficiency") {
+        Book_Hist(dir, name, efficiency_hist, binning);
+        Book_Hist(dir, name + "_den", plain_hist, binning);
+    } else {
+        std::cout << "Histogram " << name << " has unknown type " << type << ". Skipping." << std::endl;
+    }
+}
+
+// Book_Hist adds a histogram with the given type and binning to the
+// layout and gives it the next free id.
+void histManager::Book_Hist(const std::string &dir, const std::string &name, hist_type type, const nlohmann::json &binning) {
+    Hist_Definition def;
+    def.dir = dir;
+    def.name = name;
+    def.type = type;
+    def.offset = layout->nbins;
+    auto path = dir.empty() ? name : dir + "/" + name;
+    if (binning.size() == 3) {
+        def.x = Hist_Axis{binning.at(0), binning.at(1), binning.at(2)};
+        def.y = Hist_Axis{0, 0., 0.};
+        ids_1d[path] = layout->hists_1d.size();
+        layout->hists_1d.push_back(def);
+        layout->nbins += def.x.nbins + 2;
+    } else if (binning.size() == 6) {
+        def.x = Hist_Axis{binning.at(0), binning.at(1), binning.at(2)};
+        def.y = Hist_Axis{binning.at(3), binning.at(4), binning.at(5)};
+        ids_2d[path] = layout->hists_2d.size();
+        layout->hists_2d.push_back(def);
+        layout->nbins += (def.x.nbins + 2) * (def.y.nbins + 2);
+    } else {
+        std::cout << "Histogram " << name << " has the wrong number of bins. Skipping." << std::endl;
+    }
 }
 
-// FillPrevBins fills the correct bin for the provided var-value as well as
-// filling all bins bin_value < var. This is useful for finding things like
-// efficiency as a function of pT.
-void histManager::FillPrevBins(std::string name, double var, double weight) {
-    auto bin = hists_1d.at(name)->FindBin(var);
-    for (auto ibin = 0; ibin <= bin; ibin++) {
-        auto content = hists_1d.at(name)->GetBinContent(ibin);
-        hists_1d.at(name)->SetBinContent(ibin, content + weight);
+// Book_Directory books all histograms in the json object inside
+// of the given directory.
+void histManager::Book_Directory(const std::string &dir, const nlohmann::json &definitions) {
+    for (auto jt = definitions.begin(); jt != definitions.end(); jt++) {
+        Book(dir, jt.key(), jt.value());
     }
 }
 
-// Write all histograms to the root of the file.
+// Book_Regions books the "regions" block of the json config. The block
+// gives the region axes and the variables to book in every region
+//     "regions": {
+//         "axes": [["charge", "OS", "SS"], ["tau_id", "pass", "fail"]],
+//         "variables": {"Z_mass": [30, 0, 140]}
+//     }
+// Each region gets its own directory (OS_pass, SS_pass, ...) holding
+// all variables. Regions are booked in order of their index, so all
+// region histograms sit next to each other in the id table.
+//
+// An optional "systematics" list, e.g. ["pileup_up", "pileup_down"],
+// books another copy of every region for each shift (OS_pass_pileup_up,
+// ...). The analyzer fills them with the shifted weights in the same
+// pass as the nominal histograms.
+void histManager::Book_Regions(const nlohmann::json &block) {
+    regions = Region_Axes(block.at("axes"));
+    std::vector<std::string> suffixes = {""};
+    if (block.count("systematics") > 0) {
+        for (auto &systematic : block.at("systematics")) {
+            suffixes.push_back("_" + systematic.get<std::string>());
+        }
+    }
+    for (auto &suffix : suffixes) {
+        for (unsigned region = 0; region < regions.size(); region++) {
+            Book_Directory(regions.getRegionName(region) + suffix, block.at("variables"));
+        }
+    }
+}
+
+// Book_Combinations books a histogram counting the events firing the
+// OR of every combination of N trigger paths
+//     "triggers": {"type": "combinations", "paths": ["HLTJet[37]", "HLTJet[38]"]}
+// Every event is filled once, into the bin of the pattern of paths it
+// fired (see Trigger_Pattern in triggers.h), so the cost per event
+// doesn't depend on the number of combinations. Write turns the
+// patterns into the 2^N - 1 combinations. Up to 16 paths are allowed.
+void histManager::Book_Combinations(const std::string &dir, const std::string &name, const nlohmann::json &paths) {
+    if (paths.size() < 1 || paths.size() > 16) {
+        std::cout << "Histogram " << name << " needs 1 to 16 trigger paths. Skipping." << std::endl;
+        return;
+    }
+    auto npatterns = 1 << paths.size();
+    Book_Hist(dir, name, combination_hist, nlohmann::json::array({npatterns, 0.5, npatterns + 0.5}));
+    for (auto &path : paths) {
+        layout->hists_1d.back().labels.push_back(path);
+    }
+}
+
+// Get1D returns the handle of the 1D histogram with the given name,
+// e.g. "OS_pass/Z_mass". A name that wasn't booked from the json
+// config throws, so call it before the event loop.
+Hist_1D histManager::Get1D(const std::string &name) const {
+    auto id = ids_1d.find(name);
+    if (id == ids_1d.end()) {
+        throw std::invalid_argument("histManager: 1D histogram " + name + " is not in the json config");
+    }
+    return Hist_1D{id->second};
+}
+
+// Get2D returns the handle of the 2D histogram with the given name.
+Hist_2D histManager::Get2D(const std::string &name) const {
+    auto id = ids_2d.find(name);
+    if (id == ids_2d.end()) {
+        throw std::invalid_argument("histManager: 2D histogram " + name + " is not in the json config");
+    }
+    return Hist_2D{id->second};
+}
+
+// GetEfficiency returns the handle of the efficiency with the given
+// name. Throws if it isn't booked as an efficiency.
+Hist_Eff histManager::GetEfficiency(const std::string &name) const {
+    auto hist = Get1D(name);
+    if (layout->hists_1d.at(hist.id).type != efficiency_hist) {
+        throw std::invalid_argument("histManager: histogram " + name + " is not an efficiency");
+    }
+    return Hist_Eff{hist.id};
+}
+
+// GetCombinations returns the handle of the combination histogram
+// with the given name. Throws if it isn't booked as combinations.
+Hist_Combinations histManager::GetCombinations(const std::string &name) const {
+    auto hist = Get1D(name);
+    auto &def = layout->hists_1d.at(hist.id);
+    if (def.type != combination_hist) {
+        throw std::invalid_argument("histManager: histogram " + name + " is not a trigger combination histogram");
+    }
+    return Hist_Combinations{hist.id, def.labels};
+}
+
+// GetRegions returns the handle to the given variables in all regions.
+// The axes have to be listed in the same order as in the json config,
+// since the analyzer builds the region index from them. With a
+// systematic, the handle points to the regions booked for that shift.
+// Any mismatch throws, so call it before the event loop.
+Region_Hists histManager::GetRegions(const std::vector<std::string> &axes, const std::vector<std::string> &variables,
+                                     const std::string &systematic) const {
+    if (axes != regions.getAxisNames()) {
+        throw std::invalid_argument("histManager: region axes don't match the json config");
+    }
+    auto suffix = systematic.empty() ? "" : "_" + systematic;
+    Region_Hists hists{static_cast<unsigned>(variables.size()), {}};
+    for (unsigned region = 0; region < regions.size(); region++) {
+        for (auto &variable : variables) {
+            hists.ids.push_back(Get1D(regions.getRegionName(region) + suffix + "/" + variable).id);
+        }
+    }
+    return hists;
+}
+
+// Write converts all histograms to TH1F/TH2F, writes them to their
+// directories in the output file and closes the file.
 void histManager::Write() {
+    total.Flush();
+    std::vector<TH1 *> hists_1d;
+    for (unsigned i = 0; i < layout->hists_1d.size(); i++) {
+        hists_1d.push_back(Write_Hist(layout->hists_1d.at(i), total, total.getEntries1D(Hist_1D{i})));
+    }
+    for (unsigned i = 0; i < layout->hists_2d.size(); i++) {
+        Write_Hist(layout->hists_2d.at(i), total, total.getEntries2D(Hist_2D{i}));
+    }
+    for (unsigned i = 0; i < layout->hists_1d.size(); i++) {
+        if (layout->hists_1d.at(i).type == efficiency_hist) {
+            Write_Efficiency(layout->hists_1d.at(i), hists_1d.at(i), hists_1d.at(i + 1));
+        }
+    }
     fout->cd();
     fout->Write();
     fout->Close();
 }
 
+// combination_order returns the combinations of npaths trigger paths
+// as bit patterns, ordered by the number of paths and then by the
+// positions of the paths: 1, 2, 4, ..., 3, 5, 6, ..., 7, ... The empty
+// pattern comes first and stands for all events.
+std::vector<unsigned> combination_order(unsigned npaths) {
+    std::vector<unsigned> order;
+    for (unsigned pattern = 0; pattern < (1u << npaths); pattern++) {
+        order.push_back(pattern);
+    }
+    std::sort(order.begin(), order.end(), [](unsigned a, unsigned b) {
+        auto na = __builtin_popcount(a), nb = __builtin_popcount(b);
+        if (na != nb) {
+            return na < nb;
+        }
+        // the lower path decides, the same as comparing the lists of paths
+        auto differ = a ^ b;
+        return (a & differ & -differ) != 0;
+    });
+    return order;
+}
+
+// combination_labels returns the label of every bin of a combination
+// histogram, e.g. "HLTJet[37] || HLTJet[38]".
+std::vector<std::string> combination_labels(const std::vector<std::string> &paths) {
+    std::vector<std::string> labels;
+    for (auto pattern : combination_order(paths.size())) {
+        std::string label;
+        for (unsigned path = 0; path < paths.size(); path++) {
+            if (pattern >> path & 1) {
+                label += (label.empty() ? "" : " || ") + paths.at(path);
+            }
+        }
+        labels.push_back(pattern == 0 ? "all" : label);
+    }
+    return labels;
+}
+
+// or_combinations turns the bins of a combination histogram from
+// patterns of fired paths (bin p + 1 holds the events firing exactly
+// the paths in p) into combinations (bin b + 1 holds the events firing
+// any path of the b-th combination of combination_order). An event
+// fails the OR of a combination only if all its fired paths are
+// outside the combination, so
+//     OR(c) = all events - sum of the patterns inside the complement of c
+// The sums over all subsets are found for every pattern at once with
+// npaths passes over the bins, instead of looping over all pairs.
+std::vector<double> or_combinations(const std::vector<double> &bins, unsigned npaths) {
+    auto npatterns = 1u << npaths;
+    std::vector<double> subset_sums(bins.begin() + 1, bins.begin() + 1 + npatterns);
+    for (unsigned path = 0; path < npaths; path++) {
+        for (unsigned pattern = 0; pattern < npatterns; pattern++) {
+            if (pattern >> path & 1) {
+                subset_sums[pattern] += subset_sums[pattern ^ (1u << path)];
+            }
+        }
+    }
+    auto all = subset_sums[npatterns - 1];
+    std::vector<double> combinations(bins.size(), 0.);
+    auto order = combination_order(npaths);
+    for (unsigned bin = 0; bin < npatterns; bin++) {
+        auto pattern = order.at(bin);
+        combinations[bin + 1] = pattern == 0 ? all : all - subset_sums[~pattern & (npatterns - 1)];
+    }
+    return combinations;
+}
+
+// Write_Hist creates the ROOT histogram for one definition and copies
+// the bin contents and errors from the buffer. The histogram belongs
+// to the output file. Statistics like the mean are recomputed from the
+// bin contents.
+TH1 *histManager::Write_Hist(const Hist_Definition &def, const Hist_Buffer &buffer, double entries) {
+    cd(def.dir);
+    TH1 *hist(nullptr);
+    int nbins(0);
+    if (def.y.nbins == 0) {
+        hist = new TH1F(def.name.c_str(), def.name.c_str(), def.x.nbins, def.x.low, def.x.high);
+        nbins = def.x.nbins + 2;
+    } else {
+        hist = new TH2F(def.name.c_str(), def.name.c_str(), def.x.nbins, def.x.low, def.x.high, def.y.nbins, def.y.low, def.y.high);
+        nbins = (def.x.nbins + 2) * (def.y.nbins + 2);
+    }
+
+    auto first = def.offset;
+    std::vector<double> sumw(buffer.getSumW().begin() + first, buffer.getSumW().begin() + first + nbins);
+    std::vector<double> sumw2(buffer.getSumW2().begin() + first, buffer.getSumW2().begin() + first + nbins);
+    if (def.type == cumulative_hist) {
+        // every fill is counted once in every bin at or below its own bin,
+        // so both the contents and the variances are summed
+        for (auto bin = nbins - 2; bin >= 0; bin--) {
+            sumw[bin] += sumw[bin + 1];
+            sumw2[bin] += sumw2[bin + 1];
+        }
+    } else if (def.type == combination_hist) {
+        sumw = or_combinations(sumw, def.labels.size());
+        sumw2 = or_combinations(sumw2, def.labels.size());
+    }
+
+    hist->Sumw2();
+    for (auto bin = 0; bin < nbins; bin++) {
+        hist->SetBinContent(bin, sumw[bin]);
+        hist->SetBinError(bin, std::sqrt(sumw2[bin]));
+    }
+    if (def.type == combination_hist) {
+        auto labels = combination_labels(def.labels);
+        for (unsigned bin = 0; bin < labels.size(); bin++) {
+            hist->GetXaxis()->SetBinLabel(bin + 1, labels.at(bin).c_str());
+        }
+    }
+    hist->ResetStats();
+    hist->SetEntries(entries);
+    fout->cd();
+    return hist;
+}
+
+// Write_Efficiency stores the ratio of numerator and denominator as
+// "name_eff" next to them. The errors are binomial, which also takes
+// care of weighted events.
+void histManager::Write_Efficiency(const Hist_Definition &def, TH1 *numerator, TH1 *denominator) {
+    cd(def.dir);
+    auto name = def.name + "_eff";
+    auto efficiency = new TH1F(name.c_str(), name.c_str(), def.x.nbins, def.x.low, def.x.high);
+    efficiency->Divide(numerator, denominator, 1., 1., "B");
+    fout->cd();
+}
+
+// cd changes to the given directory of the output file, creating it
+// if needed. An empty name is the root of the file.
+void histManager::cd(const std::string &dir) {
+    if (dir.empty()) {
+        fout->cd();
+        return;
+    }
+    if (fout->GetDirectory(dir.c_str()) == nullptr) {
+        fout->mkdir(dir.c_str());
+    }
+    fout->cd(dir.c_str());
+}
+
 #endif  // INTERFACE_HISTMANAGER_H_
@@ -0,0 +1,283 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_HIST_BUFFER_H_
+#define INTERFACE_HIST_BUFFER_H_
+
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Hist_1D and Hist_2D are handles to booked histograms. They
+// are looked up by name once with Get1D or Get2D before the event
+// loop and then used for filling, so no strings are built or
+// compared per event. Using two types keeps a 1D handle from being
+// passed where a 2D histogram is expected.
+struct Hist_1D {
+    unsigned id;
+};
+
+struct Hist_2D {
+    unsigned id;
+};
+
+// Hist_Eff is a handle to an efficiency histogram. id is the 1D
+// histogram holding the numerator, the denominator is id + 1.
+struct Hist_Eff {
+    unsigned id;
+};
+
+// Hist_Combinations is a handle to a trigger combination histogram.
+// paths are the names of the trigger paths, in the order of the bits
+// of the pattern of fired paths passed to Fill.
+struct Hist_Combinations {
+    unsigned id;
+    std::vector<std::string> paths;
+};
+
+// Region_Hists is a handle to a set of 1D histograms booked in every
+// region of the json "regions" block. The histograms of region r are
+// ids[r * nvars] to ids[(r + 1) * nvars - 1].
+struct Region_Hists {
+    unsigned nvars;
+    std::vector<unsigned> ids;
+};
+
+// Hist_Axis is a fixed-width binning. Bin 0 is the underflow and
+// bin nbins + 1 the overflow, the same as in ROOT.
+struct Hist_Axis {
+    int nbins;
+    double low, high;
+
+    // FindBin returns the bin holding x the same way as TAxis::FindFixBin.
+    int FindBin(double x) const {
+        if (x < low) {
+            return 0;
+        } else if (!(x < high)) {
+            return nbins + 1;
+        }
+        return 1 + static_cast<int>(nbins * (x - low) / (high - low));
+    }
+};
+
+// enum for the type of a booked histogram. Only the way the
+// histogram is written is different, all types are filled the same.
+enum hist_type {
+    plain_hist,
+    cumulative_hist,  // every bin holds the sum of all bins at or above it
+    efficiency_hist,  // numerator of an efficiency, followed by its denominator
+    combination_hist  // filled with the pattern of fired paths, written as the OR of every combination of paths
+};
+
+// Hist_Definition holds everything needed to create the ROOT
+// histogram once filling is done. y.nbins is 0 for 1D histograms.
+struct Hist_Definition {
+    std::string dir, name;  // dir is empty for the root of the file
+    hist_type type;
+    Hist_Axis x, y;
+    unsigned offset;                  // position of bin 0 in the Hist_Buffer arrays
+    std::vector<std::string> labels;  // trigger paths of a combination histogram
+};
+
+// Hist_Layout lists all booked histograms indexed by the id of
+// their handle. It is shared by all buffers of a histManager.
+struct Hist_Layout {
+    Hist_Layout() : nbins(0) {}
+    std::vector<Hist_Definition> hists_1d, hists_2d;
+    unsigned nbins;  // total number of bins, including under/overflow
+};
+
+// Hist_Buffer holds the contents of all histograms of a layout as
+// dense arrays of the sum of weights and sum of weights squared per
+// bin. Filling only touches these arrays, so a buffer can be filled
+// by one thread without any locking and without creating any ROOT
+// objects. Buffers are added together with Add and only converted to
+// TH1F/TH2F by histManager::Write.
+//
+// With Set_Fill_Buffer, 1D fills are first stored as (x, weight)
+// pairs per histogram. Once a histogram has collected the given number
+// of fills, all bin numbers are computed in one simple loop the compiler
+// can vectorize and the weights are added afterwards. Each bin still
+// receives its weights in the order they were filled, so the contents
+// are the same as without buffering. Flush must be called before the
+// contents are read, which histManager::Merge and histManager::Write
+// take care of.
+class Hist_Buffer {
+   public:
+    Hist_Buffer() : fill_buffer(0) {}
+    explicit Hist_Buffer(std::shared_ptr<const Hist_Layout>, unsigned fill_buffer = 0);
+    void Fill(Hist_1D, double, double);
+    void Fill2d(Hist_2D, double, double, double);
+    void FillBin(Hist_1D, int, double);
+    void Fill(Hist_Eff, double, bool, double);
+    void Fill(const Hist_Combinations &hist, unsigned pattern, double weight) { FillBin(Hist_1D{hist.id}, pattern + 1, weight); }
+    void Fill(const Region_Hists &, unsigned, std::initializer_list<double>, double);
+    void Add(const Hist_Buffer &);
+    void Reset();
+    void Set_Fill_Buffer(unsigned);
+    void Flush();
+
+    // getters
+    const std::vector<double> &getSumW() const { return sumw; }
+    const std::vector<double> &getSumW2() const { return sumw2; }
+    double getEntries1D(Hist_1D hist) const { return entries.at(hist.id); }
+    double getEntries2D(Hist_2D hist) const { return entries.at(layout->hists_1d.size() + hist.id); }
+
+   private:
+    // Pending holds the fills of one histogram that haven't been
+    // added to the bins yet.
+    struct Pending {
+        std::vector<double> x, w;
+    };
+
+    void Add_Weight(unsigned bin, double weight) {
+        sumw[bin] += weight;
+        sumw2[bin] += weight * weight;
+    }
+    void Flush_Hist(unsigned);
+
+    std::shared_ptr<const Hist_Layout> layout;
+    std::vector<double> sumw, sumw2;
+    std::vector<double> entries;  // 1D histograms followed by 2D histograms
+    unsigned fill_buffer;          // number of fills kept per histogram, 0 when not buffering
+    std::vector<Pending> pending;  // indexed by the id of the 1D histogram
+    std::vector<int> bins;         // scratch space for the bin numbers while flushing
+};
+
+// Hist_Buffer creates empty arrays for all histograms in the layout.
+Hist_Buffer::Hist_Buffer(std::shared_ptr<const Hist_Layout> _layout, unsigned _fill_buffer) : layout(_layout), fill_buffer(0) {
+    Reset();
+    Set_Fill_Buffer(_fill_buffer);
+}
+
+// Fill fills the given 1D histogram with the provided variable and event weight.
+void Hist_Buffer::Fill(Hist_1D hist, double var, double weight) {
+    entries[hist.id]++;
+    if (fill_buffer > 0) {
+        auto &fills = pending[hist.id];
+        fills.x.push_back(var);
+        fills.w.push_back(weight);
+        if (fills.x.size() >= fill_buffer) {
+            Flush_Hist(hist.id);
+        }
+        return;
+    }
+    auto &def = layout->hists_1d[hist.id];
+    Add_Weight(def.offset + def.x.FindBin(var), weight);
+}
+
+// Fill2d fills the given 2D histogram with the provided variables and event
+// weight. Bins are numbered the same way as the global bins of a TH2.
+void Hist_Buffer::Fill2d(Hist_2D hist, double var1, double var2, double weight) {
+    auto &def = layout->hists_2d[hist.id];
+    Add_Weight(def.offset + def.x.FindBin(var1) + (def.x.nbins + 2) * def.y.FindBin(var2), weight);
+    entries[layout->hists_1d.size() + hist.id]++;
+}
+
+// FillBin fills the given 1D histogram at the requested bin with an event
+// weight. Bins outside of the histogram are ignored, like in SetBinContent.
+void Hist_Buffer::FillBin(Hist_1D hist, int bin, double weight) {
+    if (fill_buffer > 0) {
+        Flush_Hist(hist.id);  // keep the order of the fills
+    }
+    auto &def = layout->hists_1d[hist.id];
+    if (bin < 0 || bin > def.x.nbins + 1) {
+        return;
+    }
+    Add_Weight(def.offset + bin, weight);
+    entries[hist.id]++;
+}
+
+// Fill fills the denominator of the given efficiency and, if the
+// event passed, the numerator.
+void Hist_Buffer::Fill(Hist_Eff hist, double var, bool passed, double weight) {
+    Fill(Hist_1D{hist.id + 1}, var, weight);
+    if (passed) {
+        Fill(Hist_1D{hist.id}, var, weight);
+    }
+}
+
+// Fill fills one value per variable into the histograms of the given
+// region. The values are given in the same order as the variables
+// passed to histManager::GetRegions. Throws if the number of values
+// doesn't match the variables or the region wasn't booked.
+void Hist_Buffer::Fill(const Region_Hists &hists, unsigned region, std::initializer_list<double> values, double weight) {
+    if (values.size() != hists.nvars) {
+        throw std::invalid_argument("Hist_Buffer: " + std::to_string(values.size()) + " values given for " + std::to_string(hists.nvars) +
+                                    " region variables");
+    }
+    if ((region + 1) * hists.nvars > hists.ids.size()) {
+        throw std::invalid_argument("Hist_Buffer: region " + std::to_string(region) + " isn't booked");
+    }
+    auto id = hists.ids.data() + region * hists.nvars;
+    for (auto value : values) {
+        Fill(Hist_1D{*id++}, value, weight);
+    }
+}
+
+// Add adds the contents of other to this buffer. Both buffers must
+// use the same layout and other must be flushed. Adding the same
+// buffers in the same order always gives the same result, bit for bit.
+void Hist_Buffer::Add(const Hist_Buffer &other) {
+    for (unsigned i = 0; i < sumw.size(); i++) {
+        sumw[i] += other.sumw[i];
+        sumw2[i] += other.sumw2[i];
+    }
+    for (unsigned i = 0; i < entries.size(); i++) {
+        entries[i] += other.entries[i];
+    }
+}
+
+// Reset empties all histograms.
+void Hist_Buffer::Reset() {
+    sumw.assign(layout->nbins, 0.);
+    sumw2.assign(layout->nbins, 0.);
+    entries.assign(layout->hists_1d.size() + layout->hists_2d.size(), 0.);
+    pending.assign(fill_buffer > 0 ? layout->hists_1d.size() : 0, Pending());
+}
+
+// Set_Fill_Buffer sets how many fills are collected per histogram
+// before they are added to the bins. 0 turns buffering off.
+void Hist_Buffer::Set_Fill_Buffer(unsigned size) {
+    Flush();
+    fill_buffer = size;
+    pending.assign(fill_buffer > 0 ? layout->hists_1d.size() : 0, Pending());
+}
+
+// Flush adds all pending fills to the bins. The memory used for the
+// pending fills is released, since a buffer usually isn't filled again
+// once it is flushed.
+void Hist_Buffer::Flush() {
+    for (unsigned i = 0; i < pending.size(); i++) {
+        Flush_Hist(i);
+        std::vector<double>().swap(pending[i].x);
+        std::vector<double>().swap(pending[i].w);
+    }
+}
+
+// Flush_Hist adds the pending fills of one histogram to its bins. The
+// bin numbers are computed first without touching the bins, the same
+// way as Hist_Axis::FindBin.
+void Hist_Buffer::Flush_Hist(unsigned id) {
+    auto &fills = pending[id];
+    auto n = fills.x.size();
+    if (n == 0) {
+        return;
+    }
+    auto &def = layout->hists_1d[id];
+    const int nbins = def.x.nbins;
+    const double low = def.x.low, high = def.x.high;
+    const double *x = fills.x.data();
+    bins.resize(n);
+    for (unsigned i = 0; i < n; i++) {
+        bins[i] = x[i] < low ? 0 : (x[i] < high ? 1 + static_cast<int>(nbins * (x[i] - low) / (high - low)) : nbins + 1);
+    }
+    for (unsigned i = 0; i < n; i++) {
+        Add_Weight(def.offset + bins[i], fills.w[i]);
+    }
+    fills.x.clear();
+    fills.w.clear();
+}
+
+#endif  // INTERFACE_HIST_BUFFER_H_
@@ -0,0 +1,143 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_INPUT_FILES_H_
+#define INTERFACE_INPUT_FILES_H_
+
+#include <glob.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TChain.h"
+
+// is_file_list returns true if the name refers to a text file
+// listing input files instead of a ROOT file.
+bool is_file_list(const std::string &name) {
+    for (auto ext : {".txt", ".list"}) {
+        auto len = std::string(ext).size();
+        if (name.size() > len && name.compare(name.size() - len, len, ext) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// expand_glob returns all local files matching the pattern in
+// alphabetical order. Remote files (anything with a "://") and
+// patterns without matches are returned unchanged so that ROOT
+// can report a sensible error when opening them.
+std::vector<std::string> expand_glob(const std::string &pattern) {
+    if (pattern.find("://") != std::string::npos) {
+        return {pattern};
+    }
+    glob_t matches;
+    std::vector<std::string> files;
+    if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+        for (size_t i = 0; i < matches.gl_pathc; i++) {
+            files.push_back(matches.gl_pathv[i]);
+        }
+    }
+    globfree(&matches);
+    if (files.empty()) {
+        files.push_back(pattern);
+    }
+    return files;
+}
+
+// expand_inputs converts the values passed with -i into a list of
+// ROOT files. Every value can be a single file, a glob pattern or a
+// text file (.txt or .list) with one file or pattern per line. Empty
+// lines and lines starting with # are skipped in file lists.
+std::vector<std::string> expand_inputs(const std::vector<std::string> &inputs) {
+    std::vector<std::string> files;
+    for (auto &input : inputs) {
+        std::vector<std::string> patterns;
+        if (is_file_list(input)) {
+            std::ifstream file_list(input);
+            std::string line;
+            while (std::getline(file_list, line)) {
+                line.erase(0, line.find_first_not_of(" \t"));
+                line.erase(line.find_last_not_of(" \t\r") + 1);
+                if (!line.empty() && line.at(0) != '#') {
+                    patterns.push_back(line);
+                }
+            }
+        } else {
+            patterns.push_back(input);
+        }
+
+        for (auto &pattern : patterns) {
+            for (auto &file : expand_glob(pattern)) {
+                files.push_back(file);
+            }
+        }
+    }
+    return files;
+}
+
+// sample_name strips the path and extension from a file name
+// leaving the name of the sample (e.g. "DYJetsToLL_M-50_HT-100to200").
+// Samples split over numbered files ("DYJets_1.root", "DYJets_2.root")
+// also have the number removed so all files map to the same sample.
+std::string sample_name(const std::string &file_name) {
+    auto name = file_name.substr(file_name.rfind("/") + 1, std::string::npos);
+    name = name.substr(0, name.rfind(".root"));
+    auto underscore = name.rfind("_");
+    if (underscore != std::string::npos && underscore + 1 < name.size() &&
+        name.find_first_not_of("0123456789", underscore + 1) == std::string::npos) {
+        name = name.substr(0, underscore);
+    }
+    return name;
+}
+
+// temp_file_name returns a name next to file_name that is unique to
+// this process. Caches are written to it and then renamed with
+// replace_file, so jobs sharing a cache directory never read a file
+// that is still being written.
+std::string temp_file_name(const std::string &file_name) {
+    return file_name + ".tmp" + std::to_string(getpid());
+}
+
+// replace_file closes fout, which wrote temp_name, and renames it to
+// file_name. The rename is atomic, so readers see either the old or
+// the new file. Returns false, and removes temp_name, if writing failed.
+bool replace_file(std::ofstream *fout, const std::string &temp_name, const std::string &file_name) {
+    fout->close();
+    if (fout->fail() || std::rename(temp_name.c_str(), file_name.c_str()) != 0) {
+        std::remove(temp_name.c_str());
+        return false;
+    }
+    return true;
+}
+
+// build_chain adds all files to a new TChain. When the number of
+// entries in every file is already known (see entries_per_file),
+// passing them along means TChain doesn't have to open every file
+// to count the entries again.
+std::shared_ptr<TChain> build_chain(const std::vector<std::string> &files, std::string tree_name,
+                                    const std::vector<Long64_t> &entries = {}) {
+    auto chain = std::make_shared<TChain>(tree_name.c_str());
+    for (unsigned i = 0; i < files.size(); i++) {
+        if (i < entries.size()) {
+            chain->Add(files.at(i).c_str(), entries.at(i));
+        } else {
+            chain->Add(files.at(i).c_str());
+        }
+    }
+    return chain;
+}
+
+// entries_per_file returns the number of entries in each file of the chain.
+std::vector<Long64_t> entries_per_file(TChain *chain) {
+    std::vector<Long64_t> entries;
+    chain->GetEntries();  // makes sure all offsets are known
+    auto offsets = chain->GetTreeOffset();
+    for (auto i = 0; i < chain->GetNtrees(); i++) {
+        entries.push_back(offsets[i + 1] - offsets[i]);
+    }
+    return entries;
+}
+
+#endif  // INTERFACE_INPUT_FILES_H_
@@ -5,68 +5,102 @@
 
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
-#include "TLorentzVector.h"
+#include "./branch_registry.h"
+#include "./collection.h"
+#include "./p4.h"
+#include "./selection.h"
 #include "TTree.h"
 
-class Jets;  // Jets combines all tau information
-typedef std::vector<Jets> VJets;
+class Jets;  // Jets combines all jet information
+typedef Collection<Jets> VJets;
 
-// Jets combines all jet related information along with
-// creating the jet 4-vector. Helper functions are provided
-// to access properties of the jets. These properties cannot
-// be updated.
+// Jets gives access to all jet related information along with
+// creating the jet 4-vector. The information is stored in the
+// Columns of a VJets and the Jets only points to its row, so it
+// is cheap to copy. Helper functions are provided to access
+// properties of the jets. These properties cannot be updated.
 class Jets {
-    friend class Jets_Factory;  // Jet_Factory constructs individual Jets
-
    public:
-    Jets(Float_t _pt, Float_t _eta, Float_t _phi, Float_t _en) { this->p4.SetPtEtaPhiE(_pt, _eta, _phi, _en); }
-    Jets() { this->p4.SetPtEtaPhiE(0, 0, 0, 0); }
+    // Columns holds every jet variable for all jets in the event.
+    struct Columns {
+        std::vector<Float_t> pt, eta, phi, mass, CSV2BJetTags, DeepCSVTags_b, DeepCSVTags_bb, DeepCSVTags_c, DeepCSVTags_udsg;
+        std::vector<Int_t> PartonID, HadFlvr, ID;
+        std::vector<Bool_t> PFLooseId;
+        void clear();
+
+        // Visit calls f->Column(name, column) for every column, so all
+        // columns can be written to or read from a cache (column_cache.h).
+        template <typename C, typename F>
+        static void Visit(C &columns, F *f) {
+            f->Column("pt", columns.pt);
+            f->Column("eta", columns.eta);
+            f->Column("phi", columns.phi);
+            f->Column("mass", columns.mass);
+            f->Column("CSV2BJetTags", columns.CSV2BJetTags);
+            f->Column("DeepCSVTags_b", columns.DeepCSVTags_b);
+            f->Column("DeepCSVTags_bb", columns.DeepCSVTags_bb);
+            f->Column("DeepCSVTags_c", columns.DeepCSVTags_c);
+            f->Column("DeepCSVTags_udsg", columns.DeepCSVTags_udsg);
+            f->Column("PartonID", columns.PartonID);
+            f->Column("HadFlvr", columns.HadFlvr);
+            f->Column("ID", columns.ID);
+            f->Column("PFLooseId", columns.PFLooseId);
+        }
+    };
+
+    Jets() : columns(nullptr), row(0) {}
+    Jets(const Columns *_columns, unsigned _row) : columns(_columns), row(_row) {}
 
     // getters
-    TLorentzVector getP4() { return p4; }
-    Float_t getPt() const { return p4.Pt(); }
-    Float_t getEta() const { return p4.Eta(); }
-    Float_t getPhi() const { return p4.Phi(); }
-    Float_t getMass() const { return p4.M(); }
-    Bool_t getJetPFLooseId() const { return PFLooseId; }
-    Int_t getPartonID() const { return PartonID; }
-    Int_t getHadFlvr() const { return HadFlvr; }
-    Int_t getID() const { return ID; }
-    Float_t getCSV2BJetTags() const { return CSV2BJetTags; }
-    Float_t getDeepCSVTags_b() const { return DeepCSVTags_b; }
-    Float_t getDeepCSVTags_bb() const { return DeepCSVTags_bb; }
-    Float_t getDeepCSVTags_c() const { return DeepCSVTags_c; }
-    Float_t getDeepCSVTags_udsg() const { return DeepCSVTags_udsg; }
+    PtEtaPhiM getP4() const { return PtEtaPhiM(getPt(), getEta(), getPhi(), getMass()); }
+    Float_t getPt() const { return columns->pt[row]; }
+    Float_t getEta() const { return columns->eta[row]; }
+    Float_t getPhi() const { return columns->phi[row]; }
+    Float_t getMass() const { return columns->mass[row]; }
+    Bool_t getJetPFLooseId() const { return columns->PFLooseId[row]; }
+    Int_t getPartonID() const { return columns->PartonID[row]; }
+    Int_t getHadFlvr() const { return columns->HadFlvr[row]; }
+    Int_t getID() const { return columns->ID[row]; }
+    Float_t getCSV2BJetTags() const { return columns->CSV2BJetTags[row]; }
+    Float_t getDeepCSVTags_b() const { return columns->DeepCSVTags_b[row]; }
+    Float_t getDeepCSVTags_bb() const { return columns->DeepCSVTags_bb[row]; }
+    Float_t getDeepCSVTags_c() const { return columns->DeepCSVTags_c[row]; }
+    Float_t getDeepCSVTags_udsg() const { return columns->DeepCSVTags_udsg[row]; }
 
    private:
-    // these should never be modified once read from the TTree
-    TLorentzVector p4;
-    Bool_t PFLooseId;
-    Int_t PartonID, HadFlvr, ID;
-    Float_t CSV2BJetTags, DeepCSVTags_b, DeepCSVTags_bb, DeepCSVTags_c, DeepCSVTags_udsg;
+    const Columns *columns;
+    unsigned row;
 };
 
 // Jets_Factory reads from the TTree and constructs
 // individual Jets objects. The Jets_Factory holds the
-// list of jets, but can provided a shared_ptr to the
-// list.
+// list of jets. The list is handed out by
+// reference and is only valid until the next Run_Factory.
 class Jets_Factory {
    public:
     Jets_Factory(TTree *, bool);
     void Run_Factory();
+    Int_t Load(Long64_t entry) { return registry.Load(entry); }  // read only this factory's branches
+    template <typename F>
+    void Cache(F *);
 
     // getters
+    const std::vector<std::string> &getBranches() { return registry.getNames(); }  // branches read by this factory
     Int_t getNTotalJets() { return nJet; }     // nJets directly from TTree
     Int_t getNGoodJets() { return nGoodJet; }  // nJets passing preselection
     Int_t getNBTags() { return nBTag; }        // nBtags passing preselection
-    std::shared_ptr<VJets> getJets() { return std::make_shared<VJets>(jets); }
+    const VJets &getJets() const { return jets; }
     Double_t HT(const VJets &);
+    Double_t HT(const Selection<Jets> &);
 
    private:
+    Branch_Registry registry;
     Bool_t is_data;
     Int_t nJet, nGoodJet, nBTag;
-    VJets jets, btags;
+    VJets jets;
+    Selection<Jets> btags;
     std::vector<Bool_t> *jetPFLooseId;
     std::vector<Int_t> *jetPartonID, *jetHadFlvr, *jetID;
     std::vector<Float_t> *jetPt, *jetEta, *jetPhi, *jetEn, *jetCSV2BJetTags, *jetDeepCSVTags_b, *jetDeepCSVTags_bb, *jetDeepCSVTags_c,
@@ -75,7 +109,8 @@ class Jets_Factory {
 
 // Set all branch addresses when constructing a Jets_Factory.
 Jets_Factory::Jets_Factory(TTree *tree, bool is_data_)
-    : is_data(is_data_),
+    : registry(tree),
+      is_data(is_data_),
       jetPt(nullptr),
       jetEta(nullptr),
       jetPhi(nullptr),
@@ -89,66 +124,70 @@ Jets_Factory::Jets_Factory(TTree *tree, bool is_data_)
       jetHadFlvr(nullptr),
       jetPFLooseId(nullptr),
       jetID(nullptr) {
-    tree->SetBranchAddress("nJet", &nJet);
-    tree->SetBranchAddress("jetPt", &jetPt);
-    tree->SetBranchAddress("jetEn", &jetEn);
-    tree->SetBranchAddress("jetEta", &jetEta);
-    tree->SetBranchAddress("jetPhi", &jetPhi);
-    tree->SetBranchAddress("jetCSV2BJetTags", &jetCSV2BJetTags);
-    tree->SetBranchAddress("jetDeepCSVTags_b", &jetDeepCSVTags_b);
-    tree->SetBranchAddress("jetDeepCSVTags_bb", &jetDeepCSVTags_bb);
-    tree->SetBranchAddress("jetDeepCSVTags_c", &jetDeepCSVTags_c);
-    tree->SetBranchAddress("jetDeepCSVTags_udsg", &jetDeepCSVTags_udsg);
-    tree->SetBranchAddress("jetPFLooseId", &jetPFLooseId);
-    tree->SetBranchAddress("jetID", &jetID);
+    registry.Bind("nJet", &nJet);
+    registry.Bind("jetPt", &jetPt);
+    registry.Bind("jetEn", &jetEn);
+    registry.Bind("jetEta", &jetEta);
+    registry.Bind("jetPhi", &jetPhi);
+    registry.Bind("jetCSV2BJetTags", &jetCSV2BJetTags);
+    registry.Bind("jetDeepCSVTags_b", &jetDeepCSVTags_b);
+    registry.Bind("jetDeepCSVTags_bb", &jetDeepCSVTags_bb);
+    registry.Bind("jetDeepCSVTags_c", &jetDeepCSVTags_c);
+    registry.Bind("jetDeepCSVTags_udsg", &jetDeepCSVTags_udsg);
+    registry.Bind("jetPFLooseId", &jetPFLooseId);
+    registry.Bind("jetID", &jetID);
     if (!is_data) {  // not available in data
-        tree->SetBranchAddress("jetPartonID", &jetPartonID);
-        tree->SetBranchAddress("jetHadFlvr", &jetHadFlvr);
+        registry.Bind("jetPartonID", &jetPartonID);
+        registry.Bind("jetHadFlvr", &jetHadFlvr);
     }
 }
 
-// Called once per event to construct the Jets. A basic
-// preselection is applied to all jets. All Jets passing
-// preselection are sorted by pT and stored.
+// Called once per event to fill the jet columns. A basic
+// preselection is applied to all jets. All jets passing
+// preselection are stored and ordered by pT.
 void Jets_Factory::Run_Factory() {
-    jets.clear();
-    btags.clear();
-    Jets jet;
+    auto &columns = jets.Reset();
     for (auto i = 0; i < nJet; i++) {
         // baseline/default selection
         if (jetPt->at(i) < 20 || fabs(jetEta->at(i)) > 3 || jetPFLooseId->at(i) < 0.5) {
             continue;
         }
-        jet = Jets(jetPt->at(i), jetEta->at(i), jetPhi->at(i), jetEn->at(i));
-        jet.CSV2BJetTags = jetCSV2BJetTags->at(i);
-        jet.DeepCSVTags_b = jetDeepCSVTags_b->at(i);
-        jet.DeepCSVTags_bb = jetDeepCSVTags_bb->at(i);
-        jet.DeepCSVTags_c = jetDeepCSVTags_c->at(i);
-        jet.DeepCSVTags_udsg = jetDeepCSVTags_udsg->at(i);
-        jet.PFLooseId = jetPFLooseId->at(i);
-        jet.ID = jetID->at(i);
-        if (!is_data) {
-            jet.PartonID = jetPartonID->at(i);
-            jet.HadFlvr = jetHadFlvr->at(i);
-        }
-        jets.push_back(jet);
-
-        // medium b-jets
-        if (jetCSV2BJetTags->at(i) > 0.8838 && fabs(jetEta->at(i)) < 2.4) {
-            btags.push_back(jet);
-        }
+        columns.pt.push_back(jetPt->at(i));
+        columns.eta.push_back(jetEta->at(i));
+        columns.phi.push_back(jetPhi->at(i));
+        columns.mass.push_back(PtEtaPhiM::FromPtEtaPhiE(jetPt->at(i), jetEta->at(i), jetPhi->at(i), jetEn->at(i)).M());
+        columns.CSV2BJetTags.push_back(jetCSV2BJetTags->at(i));
+        columns.DeepCSVTags_b.push_back(jetDeepCSVTags_b->at(i));
+        columns.DeepCSVTags_bb.push_back(jetDeepCSVTags_bb->at(i));
+        columns.DeepCSVTags_c.push_back(jetDeepCSVTags_c->at(i));
+        columns.DeepCSVTags_udsg.push_back(jetDeepCSVTags_udsg->at(i));
+        columns.PFLooseId.push_back(jetPFLooseId->at(i));
+        columns.ID.push_back(jetID->at(i));
+        columns.PartonID.push_back(is_data ? 0 : jetPartonID->at(i));  // not available in data
+        columns.HadFlvr.push_back(is_data ? 0 : jetHadFlvr->at(i));
     }
 
     // sort by pT
-    std::sort(jets.begin(), jets.end(), [](Jets &p1, Jets &p2) -> bool { return p1.getPt() > p2.getPt(); });
-    std::sort(btags.begin(), btags.end(), [](Jets &p1, Jets &p2) -> bool { return p1.getPt() > p2.getPt(); });
+    jets.Sort();
     nGoodJet = jets.size();
+
+    // medium b-jets
+    btags.Select(jets, [](const Jets &jet) -> bool { return jet.getCSV2BJetTags() > 0.8838 && fabs(jet.getEta()) < 2.4; });
     nBTag = btags.size();
 }
 
 // HT calculates the scalar sum of all hadronic
 // activity in the event.
 Double_t Jets_Factory::HT(const VJets &jets) {
+    double ht(0.);
+    for (auto pt : jets.getColumns().pt) {
+        ht += pt;
+    }
+    return ht;
+}
+
+// HT calculates the scalar sum of pT for the selected jets.
+Double_t Jets_Factory::HT(const Selection<Jets> &jets) {
     double ht(0.);
     for (auto &jet : jets) {
         ht += jet.getPt();
@@ -156,4 +195,26 @@ Double_t Jets_Factory::HT(const VJets &jets) {
     return ht;
 }
 
+// clear empties all columns while keeping their memory.
+void Jets::Columns::clear() {
+    for (auto column : {&pt, &eta, &phi, &mass, &CSV2BJetTags, &DeepCSVTags_b, &DeepCSVTags_bb, &DeepCSVTags_c, &DeepCSVTags_udsg}) {
+        column->clear();
+    }
+    for (auto column : {&PartonID, &HadFlvr, &ID}) {
+        column->clear();
+    }
+    PFLooseId.clear();
+}
+
+// Cache hands the counters and the preselected jets of the current
+// event to a Column_Cache_Writer, or fills them from a
+// Column_Cache_Reader instead of running the factory.
+template <typename F>
+void Jets_Factory::Cache(F *cache) {
+    cache->Scalar("nJet", &nJet);
+    cache->Scalar("nGoodJet", &nGoodJet);
+    cache->Scalar("nBTag", &nBTag);
+    cache->Objects("jets", &jets);
+}
+
 #endif  // INTERFACE_JETS_FACTORY_H_
@@ -0,0 +1,214 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_LUMI_MASK_H_
+#define INTERFACE_LUMI_MASK_H_
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./branch_registry.h"
+#include "./event_loop.h"
+#include "./input_files.h"
+#include "./json.hpp"
+#include "TTree.h"
+
+// Lumi_Mask holds the certified lumi sections of a golden json
+//     {"297050": [[12, 137], [193, 776]], "297056": [[12, 203]], ...}
+// The runs are kept in a sorted array and the lumi ranges of all
+// runs in one flat array, so Pass is two binary searches.
+class Lumi_Mask {
+   public:
+    explicit Lumi_Mask(const std::string &);
+    bool Pass(Int_t, Int_t) const;
+
+    // getters
+    const std::string &getName() const { return name; }
+
+   private:
+    std::string name;
+    std::vector<Int_t> runs;                     // sorted
+    std::vector<unsigned> run_offsets;           // ranges of runs[i] are lumis[run_offsets[i]] up to lumis[run_offsets[i + 1]]
+    std::vector<std::pair<Int_t, Int_t>> lumis;  // [first, last] lumi sections, sorted and merged within a run
+};
+
+// Lumi_Block is a stretch of consecutive entries of one file that
+// belong to the same run and lumi section. first and last are the
+// [first, last) entries in the file.
+struct Lumi_Block {
+    Int_t run, lumi;
+    Long64_t first, last;
+};
+
+// Lumi_Index lists the lumi blocks of one file in the order of the
+// entries. Events of a lumi section are stored next to each other in
+// the ggNtuples, so a file only has a few hundred blocks. Only the run
+// and lumis branches are read to build the index, and it is cached on
+// disk next to the pileup tables, so a lumi mask can skip entries
+// without reading them.
+class Lumi_Index {
+   public:
+    Lumi_Index() {}
+    void Build(TTree *);
+    bool Read(const std::string &, const std::string &);
+    void Write(const std::string &, const std::string &) const;
+
+    // getters
+    const std::vector<Lumi_Block> &getBlocks() const { return blocks; }
+
+   private:
+    std::vector<Lumi_Block> blocks;
+};
+
+// The Lumi_Mask constructor reads the golden json. Overlapping and
+// adjacent lumi ranges of a run are merged. Throws if the file can't
+// be read.
+Lumi_Mask::Lumi_Mask(const std::string &file_name) : name(file_name) {
+    std::ifstream fin(file_name);
+    if (!fin.good()) {
+        throw std::invalid_argument("Lumi_Mask: unable to open " + file_name);
+    }
+    nlohmann::json golden;
+    fin >> golden;
+
+    std::vector<std::pair<Int_t, std::vector<std::pair<Int_t, Int_t>>>> sections;
+    for (auto run = golden.begin(); run != golden.end(); ++run) {
+        std::vector<std::pair<Int_t, Int_t>> ranges;
+        for (auto &range : run.value()) {
+            ranges.push_back(std::make_pair(range.at(0).get<Int_t>(), range.at(1).get<Int_t>()));
+        }
+        std::sort(ranges.begin(), ranges.end());
+        sections.push_back(std::make_pair(std::stoi(run.key()), ranges));
+    }
+    std::sort(sections.begin(), sections.end());
+
+    for (auto &section : sections) {
+        runs.push_back(section.first);
+        run_offsets.push_back(lumis.size());
+        auto run_begin = lumis.size();
+        for (auto &range : section.second) {
+            if (lumis.size() > run_begin && range.first <= lumis.back().second + 1) {
+                lumis.back().second = std::max(lumis.back().second, range.second);
+            } else {
+                lumis.push_back(range);
+            }
+        }
+    }
+    run_offsets.push_back(lumis.size());
+}
+
+// Pass returns true if the lumi section of the run is certified.
+bool Lumi_Mask::Pass(Int_t run, Int_t lumi) const {
+    auto run_it = std::lower_bound(runs.begin(), runs.end(), run);
+    if (run_it == runs.end() || *run_it != run) {
+        return false;
+    }
+    auto irun = run_it - runs.begin();
+    auto begin = lumis.begin() + run_offsets[irun];
+    auto end = lumis.begin() + run_offsets[irun + 1];
+    // first range starting after lumi, the one before it is the only candidate
+    auto range = std::upper_bound(begin, end, lumi, [](Int_t value, const std::pair<Int_t, Int_t> &other) { return value < other.first; });
+    return range != begin && lumi <= (range - 1)->second;
+}
+
+// Build reads the run and lumis branches of every entry of the tree
+// and collects the lumi blocks. All other branches are disabled.
+void Lumi_Index::Build(TTree *tree) {
+    disable_all_branches(tree);
+    Branch_Registry registry(tree);
+    Int_t run(0), lumis(0);
+    registry.Bind("run", &run);
+    registry.Bind("lumis", &lumis);
+    blocks.clear();
+    for (Long64_t i = 0; i < tree->GetEntries(); i++) {
+        registry.Load(tree->LoadTree(i));
+        if (blocks.empty() || blocks.back().run != run || blocks.back().lumi != lumis) {
+            blocks.push_back(Lumi_Block{run, lumis, i, i + 1});
+        } else {
+            blocks.back().last = i + 1;
+        }
+    }
+}
+
+// Read loads an index written by Write. It returns false, and leaves
+// the index unchanged, if the file doesn't exist or was made with a
+// different key (e.g. another version of the input file).
+bool Lumi_Index::Read(const std::string &file_name, const std::string &key) {
+    std::ifstream fin(file_name);
+    std::string line;
+    if (!std::getline(fin, line) || line != key) {
+        return false;
+    }
+    size_t nblocks(0);
+    fin >> nblocks;
+    std::vector<Lumi_Block> _blocks(nblocks);
+    for (auto &block : _blocks) {
+        fin >> block.run >> block.lumi >> block.first >> block.last;
+    }
+    if (fin.fail()) {
+        return false;
+    }
+    blocks = _blocks;
+    return true;
+}
+
+// Write stores the index as text, with the key on the first line.
+// The file is only replaced once it is complete.
+void Lumi_Index::Write(const std::string &file_name, const std::string &key) const {
+    auto temp_name = temp_file_name(file_name);
+    std::ofstream fout(temp_name, std::ios::out | std::ios::trunc);
+    fout << key << std::endl;
+    fout << blocks.size() << std::endl;
+    for (auto &block : blocks) {
+        fout << block.run << " " << block.lumi << " " << block.first << " " << block.last << std::endl;
+    }
+    replace_file(&fout, temp_name, file_name);
+}
+
+// file_lumi_index returns the lumi index of one file. The index is
+// read from cache_dir if it was built before for a file with the same
+// path and number of entries. Otherwise, it is built and written to
+// cache_dir as <file name>_lumis_<hash of the path>.txt, so files with
+// the same name in different datasets don't share a cache.
+Lumi_Index file_lumi_index(const std::string &file, const std::string &tree_name, const std::string &cache_dir) {
+    auto chain = build_chain({file}, tree_name);
+    auto key = "lumis " + file + " " + tree_name + " entries " + std::to_string(chain->GetEntries());
+    auto base = file.substr(file.rfind("/") + 1, std::string::npos);
+    std::stringstream cache_name;
+    cache_name << cache_dir << "/" << base.substr(0, base.rfind(".root")) << "_lumis_" << std::hex << std::hash<std::string>()(file) << ".txt";
+    Lumi_Index index;
+    if (!index.Read(cache_name.str(), key)) {
+        index.Build(chain.get());
+        index.Write(cache_name.str(), key);
+    }
+    return index;
+}
+
+// certified_ranges returns the entries of the chain made from files
+// that pass the lumi mask, as sorted [first, last) ranges. entries
+// holds the number of entries of every file (see entries_per_file).
+std::vector<Entry_Range> certified_ranges(const Lumi_Mask &mask, const std::vector<std::string> &files, const std::vector<Long64_t> &entries,
+                                          const std::string &tree_name, const std::string &cache_dir) {
+    std::vector<Entry_Range> ranges;
+    Long64_t offset(0);
+    for (unsigned i = 0; i < files.size(); i++) {
+        for (auto &block : file_lumi_index(files.at(i), tree_name, cache_dir).getBlocks()) {
+            if (!mask.Pass(block.run, block.lumi)) {
+                continue;
+            }
+            if (!ranges.empty() && ranges.back().second == offset + block.first) {
+                ranges.back().second = offset + block.last;  // merge with the previous block
+            } else {
+                ranges.push_back(std::make_pair(offset + block.first, offset + block.last));
+            }
+        }
+        offset += entries.at(i);
+    }
+    return ranges;
+}
+
+#endif  // INTERFACE_LUMI_MASK_H_
@@ -5,66 +5,100 @@
 
 #include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
+#include "./branch_registry.h"
+#include "./collection.h"
+#include "./p4.h"
 #include "./util.h"
-#include "TLorentzVector.h"
 #include "TTree.h"
 
-class Muon;  // Tau combines all muon information
-typedef std::vector<Muon> VMuon;
+class Muon;  // Muon combines all muon information
+typedef Collection<Muon> VMuon;
 
-// Muon combines all muon related information along with
-// creating the muon 4-vector. Helper functions are provided
-// to access properties of the muons. These properties cannot
-// be updated.
+// Muon gives access to all muon related information along with
+// creating the muon 4-vector. The information is stored in the
+// Columns of a VMuon and the Muon only points to its row, so it
+// is cheap to copy. Helper functions are provided to access
+// properties of the muons. These properties cannot be updated.
 class Muon {
-    friend class Muon_Factory;  // Muon_Factory constructs individual Muons
-
    public:
-    Muon(Float_t _pt, Float_t _eta, Float_t _phi, Float_t _en) { this->p4.SetPtEtaPhiE(_pt, _eta, _phi, _en); }
-    Muon() { this->p4.SetPtEtaPhiE(0, 0, 0, 0); }
+    // Columns holds every muon variable for all muons in the event.
+    struct Columns {
+        std::vector<Float_t> pt, eta, phi, mass, D0, Dz, muIsoTrk, muPFChIso, muPFNeuIso, muPFPhoIso, muPFPUIso;
+        std::vector<Int_t> Charge, Type, IDbit, MuonHits, TrkQuality;
+        void clear();
+
+        // Visit calls f->Column(name, column) for every column, so all
+        // columns can be written to or read from a cache (column_cache.h).
+        template <typename C, typename F>
+        static void Visit(C &columns, F *f) {
+            f->Column("pt", columns.pt);
+            f->Column("eta", columns.eta);
+            f->Column("phi", columns.phi);
+            f->Column("mass", columns.mass);
+            f->Column("D0", columns.D0);
+            f->Column("Dz", columns.Dz);
+            f->Column("muIsoTrk", columns.muIsoTrk);
+            f->Column("muPFChIso", columns.muPFChIso);
+            f->Column("muPFNeuIso", columns.muPFNeuIso);
+            f->Column("muPFPhoIso", columns.muPFPhoIso);
+            f->Column("muPFPUIso", columns.muPFPUIso);
+            f->Column("Charge", columns.Charge);
+            f->Column("Type", columns.Type);
+            f->Column("IDbit", columns.IDbit);
+            f->Column("MuonHits", columns.MuonHits);
+            f->Column("TrkQuality", columns.TrkQuality);
+        }
+    };
+
+    Muon() : columns(nullptr), row(0) {}
+    Muon(const Columns *_columns, unsigned _row) : columns(_columns), row(_row) {}
 
     // getters
-    TLorentzVector getP4() { return p4; }
-    Float_t getPt() { return p4.Pt(); }
-    Float_t getEta() { return p4.Eta(); }
-    Float_t getPhi() { return p4.Phi(); }
-    Float_t getMass() { return p4.M(); }
-    Bool_t getID(working_point key) { return (IDbit >> key & 1) == 1; }
-    Float_t getCharge() { return Charge; }
-    Float_t getType() { return Type; }
-    Float_t getMuonHits() { return MuonHits; }
-    Float_t getTrkQuality() { return TrkQuality; }
-    Float_t getIsoTrk() { return muIsoTrk; }
-    Float_t getD0() { return D0; }
-    Float_t getDz() { return Dz; }
-    Float_t getPFChIso() { return muPFChIso; }
-    Float_t getPFNeuIso() { return muPFNeuIso; }
-    Float_t getPFPhoIso() { return muPFPhoIso; }
-    Float_t getPFPUIso() { return muPFPUIso; }
+    PtEtaPhiM getP4() const { return PtEtaPhiM(getPt(), getEta(), getPhi(), getMass()); }
+    Float_t getPt() const { return columns->pt[row]; }
+    Float_t getEta() const { return columns->eta[row]; }
+    Float_t getPhi() const { return columns->phi[row]; }
+    Float_t getMass() const { return columns->mass[row]; }
+    Bool_t getID(working_point key) const { return (columns->IDbit[row] >> key & 1) == 1; }
+    Float_t getCharge() const { return columns->Charge[row]; }
+    Float_t getType() const { return columns->Type[row]; }
+    Float_t getMuonHits() const { return columns->MuonHits[row]; }
+    Float_t getTrkQuality() const { return columns->TrkQuality[row]; }
+    Float_t getIsoTrk() const { return columns->muIsoTrk[row]; }
+    Float_t getD0() const { return columns->D0[row]; }
+    Float_t getDz() const { return columns->Dz[row]; }
+    Float_t getPFChIso() const { return columns->muPFChIso[row]; }
+    Float_t getPFNeuIso() const { return columns->muPFNeuIso[row]; }
+    Float_t getPFPhoIso() const { return columns->muPFPhoIso[row]; }
+    Float_t getPFPUIso() const { return columns->muPFPUIso[row]; }
 
    private:
-    // these should never be modified once read from the TTree
-    TLorentzVector p4;
-    Int_t Charge, Type, IDbit, MuonHits, TrkQuality;
-    Float_t D0, Dz, muIsoTrk, muPFChIso, muPFNeuIso, muPFPhoIso, muPFPUIso;
+    const Columns *columns;
+    unsigned row;
 };
 
 // Muon_Factory reads from the TTree and constructs
 // individual Muon objects. The Muon_Factory holds the
-// list of muons, but can provided a shared_ptr to the
-// list.
+// list of muons. The list is handed out by
+// reference and is only valid until the next Run_Factory.
 class Muon_Factory {
    public:
     explicit Muon_Factory(TTree *);
     void Run_Factory();
+    Int_t Load(Long64_t entry) { return registry.Load(entry); }  // read only this factory's branches
+    template <typename F>
+    void Cache(F *);
 
     // getters
+    const std::vector<std::string> &getBranches() { return registry.getNames(); }  // branches read by this factory
     Int_t getNTotalMuon() { return nMu; }     // nMuons directly from TTree
     Int_t getNGoodMuon() { return nGoodMu; }  // nMuons passing preselection
-    std::shared_ptr<VMuon> getMuons() { return std::make_shared<VMuon>(muons); }
+    const VMuon &getMuons() const { return muons; }
 
    private:
+    Branch_Registry registry;
     Int_t nMu, nGoodMu;
     VMuon muons;
     std::vector<Float_t> *muPt, *muEta, *muPhi, *muEn, *muD0, *muDz, *muIsoTrk, *muPFChIso, *muPFNeuIso, *muPFPhoIso, *muPFPUIso;
@@ -73,7 +107,8 @@ class Muon_Factory {
 
 // Set all branch addresses when constructing a Muon_Factory.
 Muon_Factory::Muon_Factory(TTree *tree)
-    : muPt(nullptr),
+    : registry(tree),
+      muPt(nullptr),
       muEta(nullptr),
       muPhi(nullptr),
       muEn(nullptr),
@@ -89,54 +124,76 @@ Muon_Factory::Muon_Factory(TTree *tree)
       muPFNeuIso(nullptr),
       muPFPhoIso(nullptr),
       muPFPUIso(nullptr) {
-    tree->SetBranchAddress("nMu", &nMu);
-    tree->SetBranchAddress("muPt", &muPt);
-    tree->SetBranchAddress("muEta", &muEta);
-    tree->SetBranchAddress("muPhi", &muPhi);
-    tree->SetBranchAddress("muEn", &muEn);
-    tree->SetBranchAddress("muCharge", &muCharge);
-    tree->SetBranchAddress("muType", &muType);
-    tree->SetBranchAddress("muIDbit", &muIDbit);
-    tree->SetBranchAddress("muMuonHits", &muMuonHits);
-    tree->SetBranchAddress("muTrkQuality", &muTrkQuality);
-    tree->SetBranchAddress("muD0", &muD0);
-    tree->SetBranchAddress("muDz", &muDz);
-    tree->SetBranchAddress("muIsoTrk", &muIsoTrk);
-    tree->SetBranchAddress("muPFChIso", &muPFChIso);
-    tree->SetBranchAddress("muPFNeuIso", &muPFNeuIso);
-    tree->SetBranchAddress("muPFPhoIso", &muPFPhoIso);
-    tree->SetBranchAddress("muPFPUIso", &muPFPUIso);
+    registry.Bind("nMu", &nMu);
+    registry.Bind("muPt", &muPt);
+    registry.Bind("muEta", &muEta);
+    registry.Bind("muPhi", &muPhi);
+    registry.Bind("muEn", &muEn);
+    registry.Bind("muCharge", &muCharge);
+    registry.Bind("muType", &muType);
+    registry.Bind("muIDbit", &muIDbit);
+    registry.Bind("muMuonHits", &muMuonHits);
+    registry.Bind("muTrkQuality", &muTrkQuality);
+    registry.Bind("muD0", &muD0);
+    registry.Bind("muDz", &muDz);
+    registry.Bind("muIsoTrk", &muIsoTrk);
+    registry.Bind("muPFChIso", &muPFChIso);
+    registry.Bind("muPFNeuIso", &muPFNeuIso);
+    registry.Bind("muPFPhoIso", &muPFPhoIso);
+    registry.Bind("muPFPUIso", &muPFPUIso);
 }
 
-// Called once per event to construct the Muons. A basic
-// preselection is applied to all muons. All Muons passing
-// preselection are sorted by pT and stored.
+// Called once per event to fill the muon columns. A basic
+// preselection is applied to all muons. All muons passing
+// preselection are stored and ordered by pT.
 void Muon_Factory::Run_Factory() {
-    muons.clear();
+    auto &columns = muons.Reset();
     for (auto i = 0; i < nMu; i++) {
         // baseline/default selection
         if (muPt->at(i) < 10 || fabs(muEta->at(i)) > 2.4) {
             continue;
         }
-        auto muon = Muon(muPt->at(i), muEta->at(i), muPhi->at(i), muEn->at(i));
-        muon.Charge = muCharge->at(i);
-        muon.Type = muType->at(i);
-        muon.IDbit = muIDbit->at(i);
-        muon.MuonHits = muMuonHits->at(i);
-        muon.TrkQuality = muTrkQuality->at(i);
-        muon.muIsoTrk = muIsoTrk->at(i);
-        muon.D0 = muD0->at(i);
-        muon.Dz = muDz->at(i);
-        muon.muPFChIso = muPFChIso->at(i);
-        muon.muPFNeuIso = muPFNeuIso->at(i);
-        muon.muPFPhoIso = muPFPhoIso->at(i);
-        muon.muPFPUIso = muPFPUIso->at(i);
-        muons.push_back(muon);
+        columns.pt.push_back(muPt->at(i));
+        columns.eta.push_back(muEta->at(i));
+        columns.phi.push_back(muPhi->at(i));
+        columns.mass.push_back(PtEtaPhiM::FromPtEtaPhiE(muPt->at(i), muEta->at(i), muPhi->at(i), muEn->at(i)).M());
+        columns.Charge.push_back(muCharge->at(i));
+        columns.Type.push_back(muType->at(i));
+        columns.IDbit.push_back(muIDbit->at(i));
+        columns.MuonHits.push_back(muMuonHits->at(i));
+        columns.TrkQuality.push_back(muTrkQuality->at(i));
+        columns.muIsoTrk.push_back(muIsoTrk->at(i));
+        columns.D0.push_back(muD0->at(i));
+        columns.Dz.push_back(muDz->at(i));
+        columns.muPFChIso.push_back(muPFChIso->at(i));
+        columns.muPFNeuIso.push_back(muPFNeuIso->at(i));
+        columns.muPFPhoIso.push_back(muPFPhoIso->at(i));
+        columns.muPFPUIso.push_back(muPFPUIso->at(i));
     }
 
     // sort by pT
-    std::sort(muons.begin(), muons.end(), [](Muon &p1, Muon &p2) -> bool { return p1.getPt() > p2.getPt(); });
+    muons.Sort();
     nGoodMu = muons.size();
 }
 
+// clear empties all columns while keeping their memory.
+void Muon::Columns::clear() {
+    for (auto column : {&pt, &eta, &phi, &mass, &D0, &Dz, &muIsoTrk, &muPFChIso, &muPFNeuIso, &muPFPhoIso, &muPFPUIso}) {
+        column->clear();
+    }
+    for (auto column : {&Charge, &Type, &IDbit, &MuonHits, &TrkQuality}) {
+        column->clear();
+    }
+}
+
+// Cache hands the counters and the preselected muons of the current
+// event to a Column_Cache_Writer, or fills them from a
+// Column_Cache_Reader instead of running the factory.
+template <typename F>
+void Muon_Factory::Cache(F *cache) {
+    cache->Scalar("nMu", &nMu);
+    cache->Scalar("nGoodMu", &nGoodMu);
+    cache->Objects("muons", &muons);
+}
+
 #endif  // INTERFACE_MUON_FACTORY_H_
@@ -0,0 +1,102 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_P4_H_
+#define INTERFACE_P4_H_
+
+#include <algorithm>
+#include <cmath>
+
+// PtEtaPhiM is a lightweight four-vector stored as pT, eta, phi
+// and mass, the same variables stored in the ggNtuples. Unlike
+// TLorentzVector it is not a TObject, so it is only 16 bytes and
+// trivially copyable. pT, eta and phi are read without any math,
+// while the Cartesian components are only computed when asked for.
+// Function names follow TLorentzVector so both can be used the same
+// way in analysis code.
+class PtEtaPhiM {
+   public:
+    PtEtaPhiM() : pt(0), eta(0), phi(0), m(0) {}
+    PtEtaPhiM(float _pt, float _eta, float _phi, float _m) : pt(_pt), eta(_eta), phi(_phi), m(_m) {}
+    static PtEtaPhiM FromPtEtaPhiE(float, float, float, float);
+    static PtEtaPhiM FromPxPyPzE(double, double, double, double);
+
+    // getters
+    float Pt() const { return pt; }
+    float Eta() const { return eta; }
+    float Phi() const { return phi; }
+    float M() const { return m; }
+    double Px() const { return pt * std::cos(phi); }
+    double Py() const { return pt * std::sin(phi); }
+    double Pz() const { return pt * std::sinh(eta); }
+    double P() const { return pt * std::cosh(eta); }
+    double E() const;
+    double Et() const { return std::sqrt(std::max(static_cast<double>(pt) * pt + static_cast<double>(m) * m, 0.)); }
+
+    double DeltaPhi(const PtEtaPhiM &) const;
+    double DeltaR(const PtEtaPhiM &) const;
+    PtEtaPhiM operator+(const PtEtaPhiM &) const;
+    PtEtaPhiM &operator+=(const PtEtaPhiM &);
+
+   private:
+    float pt, eta, phi, m;
+};
+
+// FromPtEtaPhiE builds a four-vector from the energy instead of
+// the mass. This is used for objects stored with their energy
+// in the ggNtuples (muons, electrons, jets).
+PtEtaPhiM PtEtaPhiM::FromPtEtaPhiE(float pt, float eta, float phi, float e) {
+    double p = pt * std::cosh(eta);
+    double m2 = static_cast<double>(e) * e - p * p;
+    return PtEtaPhiM(pt, eta, phi, m2 >= 0 ? std::sqrt(m2) : -std::sqrt(-m2));
+}
+
+// FromPxPyPzE builds a four-vector from Cartesian components.
+// Following TLorentzVector, a vector along the beam gets a large
+// eta instead of infinity and a negative mass squared gives a
+// negative mass.
+PtEtaPhiM PtEtaPhiM::FromPxPyPzE(double px, double py, double pz, double e) {
+    double pt = std::sqrt(px * px + py * py);
+    double eta = pt > 0 ? std::asinh(pz / pt) : (pz >= 0 ? 10e10 : -10e10);
+    double phi = (px == 0 && py == 0) ? 0 : std::atan2(py, px);
+    double m2 = e * e - pt * pt - pz * pz;
+    return PtEtaPhiM(pt, eta, phi, m2 >= 0 ? std::sqrt(m2) : -std::sqrt(-m2));
+}
+
+// E returns the energy. A negative mass is treated as a negative
+// mass squared.
+double PtEtaPhiM::E() const {
+    double p = P();
+    return std::sqrt(std::max(p * p + static_cast<double>(m) * std::fabs(m), 0.));
+}
+
+// DeltaPhi returns the difference in phi wrapped into [-pi, pi].
+double PtEtaPhiM::DeltaPhi(const PtEtaPhiM &other) const {
+    double dphi = phi - other.phi;
+    if (dphi > M_PI) {
+        dphi -= 2 * M_PI;
+    } else if (dphi <= -M_PI) {
+        dphi += 2 * M_PI;
+    }
+    return dphi;
+}
+
+// DeltaR returns the distance to the other vector in the eta-phi plane.
+double PtEtaPhiM::DeltaR(const PtEtaPhiM &other) const {
+    double deta = eta - other.eta;
+    double dphi = DeltaPhi(other);
+    return std::sqrt(deta * deta + dphi * dphi);
+}
+
+// operator+ adds the two vectors in Cartesian coordinates
+// and converts the sum back to pT, eta, phi and mass.
+PtEtaPhiM PtEtaPhiM::operator+(const PtEtaPhiM &other) const {
+    return FromPxPyPzE(Px() + other.Px(), Py() + other.Py(), Pz() + other.Pz(), E() + other.E());
+}
+
+// operator+= adds the other vector to this one.
+PtEtaPhiM &PtEtaPhiM::operator+=(const PtEtaPhiM &other) {
+    *this = *this + other;
+    return *this;
+}
+
+#endif  // INTERFACE_P4_H_
@@ -0,0 +1,248 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_PAIRING_H_
+#define INTERFACE_PAIRING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// enum for the charge requirement of a pair
+enum pair_charge {
+    any_charge,
+    opposite_charge,
+    same_charge
+};
+
+// enum for the metric used to rank the pairs. The best pair
+// is always the first one.
+enum pair_rank {
+    closest_mass,   // mass closest to the target mass
+    highest_pt,     // largest scalar sum of pT
+    smallest_dr     // smallest DeltaR
+};
+
+// Pair is a single candidate pair. first and second are the
+// positions of the objects in the two inputs given to Find.
+struct Pair {
+    unsigned first, second;
+    float dr, mass, pt_sum;
+};
+
+// Pair_Finder builds all pairs between two sets of objects and
+// keeps the ones passing the DeltaR window, mass window and charge
+// requirement. The pairs are ranked by the chosen metric.
+//
+// The kinematics of both inputs are first copied into contiguous
+// arrays. The full DeltaR and mass matrices are then computed with
+// simple branch-free loops the compiler can vectorize, and square
+// roots are only taken for the pairs that are kept. All arrays are
+// reused between events, so a Pair_Finder should be kept outside
+// of the event loop.
+class Pair_Finder {
+   public:
+    Pair_Finder();
+    Pair_Finder &DeltaR_Window(float, float);
+    Pair_Finder &Mass_Window(float, float);
+    Pair_Finder &Charge(pair_charge);
+    Pair_Finder &Rank(pair_rank, float target = 0.);
+    template <typename A, typename B>
+    const std::vector<Pair> &Find(const A &, const B &);
+
+    // getters
+    const std::vector<Pair> &getPairs() const { return pairs; }
+
+   private:
+    // Kinematics holds the inputs for one side of the pairs.
+    struct Kinematics {
+        std::vector<float> pt, eta, phi, charge;
+        std::vector<double> px, py, pz, e;
+    };
+    template <typename T>
+    void Load(const T &, Kinematics *);
+    void Fill_Matrices();
+    void Select_Pairs();
+
+    float min_dr, max_dr, min_mass, max_mass, target_mass;
+    bool use_mass;
+    pair_charge charge;
+    pair_rank rank;
+    Kinematics left, right;
+    std::vector<float> dr2;      // DeltaR^2 for every pair, row-major
+    std::vector<double> mass2;   // mass^2 for every pair, row-major
+    std::vector<Pair> pairs;
+};
+
+// Without any requirements, all pairs are kept and ranked
+// by DeltaR.
+Pair_Finder::Pair_Finder()
+    : min_dr(0.),
+      max_dr(1e9),
+      min_mass(-1e9),
+      max_mass(1e9),
+      target_mass(0.),
+      use_mass(false),
+      charge(any_charge),
+      rank(smallest_dr) {}
+
+// DeltaR_Window only keeps pairs with low < DeltaR < high.
+Pair_Finder &Pair_Finder::DeltaR_Window(float low, float high) {
+    min_dr = low;
+    max_dr = high;
+    return *this;
+}
+
+// Mass_Window only keeps pairs with low < mass < high.
+Pair_Finder &Pair_Finder::Mass_Window(float low, float high) {
+    min_mass = low;
+    max_mass = high;
+    use_mass = true;
+    return *this;
+}
+
+// Charge sets the required charge of the pair.
+Pair_Finder &Pair_Finder::Charge(pair_charge requirement) {
+    charge = requirement;
+    return *this;
+}
+
+// Rank sets the metric used to order the pairs. The target
+// is only used when ranking by closest_mass.
+Pair_Finder &Pair_Finder::Rank(pair_rank metric, float target) {
+    rank = metric;
+    target_mass = target;
+    if (metric == closest_mass) {
+        use_mass = true;
+    }
+    return *this;
+}
+
+// Find returns all pairs made from an object in first and an object
+// in second which pass the requirements, best pair first. The inputs
+// can be a Collection or Selection of any object with getPt, getEta,
+// getPhi, getP4 and getCharge. The returned pairs are only valid
+// until the next call to Find.
+template <typename A, typename B>
+const std::vector<Pair> &Pair_Finder::Find(const A &first, const B &second) {
+    Load(first, &left);
+    Load(second, &right);
+    Fill_Matrices();
+    Select_Pairs();
+    return pairs;
+}
+
+// Load copies the kinematics of all objects into contiguous arrays.
+template <typename T>
+void Pair_Finder::Load(const T &objects, Kinematics *kin) {
+    auto n = objects.size();
+    for (auto column : {&kin->pt, &kin->eta, &kin->phi, &kin->charge}) {
+        column->resize(n);
+    }
+    for (auto column : {&kin->px, &kin->py, &kin->pz, &kin->e}) {
+        column->resize(n);
+    }
+    for (unsigned i = 0; i < n; i++) {
+        auto object = objects[i];
+        auto p4 = object.getP4();
+        kin->pt[i] = object.getPt();
+        kin->eta[i] = object.getEta();
+        kin->phi[i] = object.getPhi();
+        kin->charge[i] = object.getCharge();
+        kin->px[i] = p4.Px();
+        kin->py[i] = p4.Py();
+        kin->pz[i] = p4.Pz();
+        kin->e[i] = p4.E();
+    }
+}
+
+// Fill_Matrices computes DeltaR^2 (and mass^2 when needed) for all
+// pairs. The difference in phi is wrapped into [0, pi].
+void Pair_Finder::Fill_Matrices() {
+    auto n1 = left.pt.size();
+    auto n2 = right.pt.size();
+    dr2.resize(n1 * n2);
+    const float pi = M_PI;
+    const float two_pi = 2 * M_PI;
+    const float *eta2 = right.eta.data();
+    const float *phi2 = right.phi.data();
+    for (unsigned i = 0; i < n1; i++) {
+        float *row = dr2.data() + i * n2;
+        const float eta1 = left.eta[i];
+        const float phi1 = left.phi[i];
+        for (unsigned j = 0; j < n2; j++) {
+            float deta = eta1 - eta2[j];
+            float dphi = std::fabs(phi1 - phi2[j]);
+            dphi = dphi > pi ? two_pi - dphi : dphi;
+            row[j] = deta * deta + dphi * dphi;
+        }
+    }
+
+    if (!use_mass) {
+        return;
+    }
+    mass2.resize(n1 * n2);
+    const double *px2 = right.px.data();
+    const double *py2 = right.py.data();
+    const double *pz2 = right.pz.data();
+    const double *e2 = right.e.data();
+    for (unsigned i = 0; i < n1; i++) {
+        double *row = mass2.data() + i * n2;
+        const double px1 = left.px[i], py1 = left.py[i], pz1 = left.pz[i], e1 = left.e[i];
+        for (unsigned j = 0; j < n2; j++) {
+            double px = px1 + px2[j], py = py1 + py2[j], pz = pz1 + pz2[j], e = e1 + e2[j];
+            row[j] = e * e - px * px - py * py - pz * pz;
+        }
+    }
+}
+
+// Select_Pairs applies all requirements and sorts the remaining
+// pairs by the ranking metric. Ties keep the order of the inputs.
+void Pair_Finder::Select_Pairs() {
+    pairs.clear();
+    auto n1 = left.pt.size();
+    auto n2 = right.pt.size();
+    auto min_dr2 = min_dr * min_dr;
+    auto max_dr2 = max_dr * max_dr;
+    for (unsigned i = 0; i < n1; i++) {
+        for (unsigned j = 0; j < n2; j++) {
+            auto idx = i * n2 + j;
+            if ((min_dr > 0 && dr2[idx] <= min_dr2) || dr2[idx] >= max_dr2) {
+                continue;
+            }
+            auto q = left.charge[i] * right.charge[j];
+            if ((charge == opposite_charge && q >= 0) || (charge == same_charge && q <= 0)) {
+                continue;
+            }
+            Pair pair = {i, j, std::sqrt(dr2[idx]), 0., left.pt[i] + right.pt[j]};
+            if (use_mass) {
+                pair.mass = mass2[idx] >= 0 ? std::sqrt(mass2[idx]) : -std::sqrt(-mass2[idx]);
+                if (pair.mass <= min_mass || pair.mass >= max_mass) {
+                    continue;
+                }
+            }
+            pairs.push_back(pair);
+        }
+    }
+
+    auto metric = rank;
+    auto target = target_mass;
+    std::sort(pairs.begin(), pairs.end(), [metric, target](const Pair &p1, const Pair &p2) -> bool {
+        float s1(0.), s2(0.);
+        if (metric == closest_mass) {
+            s1 = std::fabs(p1.mass - target);
+            s2 = std::fabs(p2.mass - target);
+        } else if (metric == highest_pt) {
+            s1 = -p1.pt_sum;
+            s2 = -p2.pt_sum;
+        } else {
+            s1 = p1.dr;
+            s2 = p2.dr;
+        }
+        if (s1 != s2) {
+            return s1 < s2;
+        }
+        return p1.first < p2.first || (p1.first == p2.first && p1.second < p2.second);
+    });
+}
+
+#endif  // INTERFACE_PAIRING_H_
@@ -0,0 +1,243 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_PILEUP_H_
+#define INTERFACE_PILEUP_H_
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./branch_registry.h"
+#include "./hist_buffer.h"
+#include "./input_files.h"
+#include "TFile.h"
+#include "TH1.h"
+
+// Pileup_Weights holds the nominal pileup weight of an event
+// and the weights for the up and down shifted data profiles.
+struct Pileup_Weights {
+    double nominal, up, down;
+};
+
+// Pileup_Table holds the data/MC pileup ratio of one sample as a
+// flat array with the nominal, up and down weight of each bin next to
+// each other. Get is a clamp and one array access, so all three weights
+// cost the same as one. A default constructed table gives a weight of
+// 1 for everything, which is used for data.
+class Pileup_Table {
+   public:
+    Pileup_Table() : nbins(1), low(0.), inv_width(0.), weights(3, 1.) {}
+    Pileup_Table(const Hist_Axis &, const std::vector<double> &);
+    Pileup_Weights Get(double true_pu) const {
+        auto bin = std::min(std::max(static_cast<int>((true_pu - low) * inv_width), 0), nbins - 1);
+        auto w = weights.data() + 3 * bin;
+        return Pileup_Weights{w[0], w[1], w[2]};
+    }
+    bool Read(const std::string &, const std::string &);
+    void Write(const std::string &, const std::string &) const;
+
+   private:
+    int nbins;
+    double low, inv_width;
+    std::vector<double> weights;  // nominal, up, down for every bin
+};
+
+// Pileup_Table stores the weights for the given binning. Values
+// outside of the binning get the weights of the first or last bin.
+Pileup_Table::Pileup_Table(const Hist_Axis &axis, const std::vector<double> &_weights)
+    : nbins(axis.nbins), low(axis.low), inv_width(axis.nbins / (axis.high - axis.low)), weights(_weights) {}
+
+// Read loads a table written by Write. It returns false, and leaves
+// the table unchanged, if the file doesn't exist or was made with a
+// different key (e.g. other data profiles).
+bool Pileup_Table::Read(const std::string &file_name, const std::string &key) {
+    std::ifstream fin(file_name);
+    std::string line;
+    if (!std::getline(fin, line) || line != key) {
+        return false;
+    }
+    int _nbins;
+    double _low, _inv_width;
+    fin >> _nbins >> _low >> _inv_width;
+    std::vector<double> _weights(3 * std::max(_nbins, 0));
+    for (auto &weight : _weights) {
+        fin >> weight;
+    }
+    if (fin.fail() || _nbins < 1) {
+        return false;
+    }
+    nbins = _nbins;
+    low = _low;
+    inv_width = _inv_width;
+    weights = _weights;
+    return true;
+}
+
+// Write stores the table as text, with the key on the first line.
+// All digits are written so reading the file back gives exactly the
+// same weights. The file is only replaced once it is complete.
+void Pileup_Table::Write(const std::string &file_name, const std::string &key) const {
+    auto temp_name = temp_file_name(file_name);
+    std::ofstream fout(temp_name, std::ios::out | std::ios::trunc);
+    fout << key << std::endl;
+    fout << std::setprecision(std::numeric_limits<double>::max_digits10);
+    fout << nbins << " " << low << " " << inv_width << std::endl;
+    for (unsigned i = 0; i < weights.size(); i += 3) {
+        fout << weights[i] << " " << weights[i + 1] << " " << weights[i + 2] << std::endl;
+    }
+    replace_file(&fout, temp_name, file_name);
+}
+
+// Pileup_Reweighting builds the pileup tables of the simulated
+// samples. The data profiles (nominal, up and down) are read once at
+// startup. The MC profile of a sample is the in-time true number of
+// interactions of all its events, which takes a pass over the sample,
+// so the finished table is cached on disk and reused by later jobs.
+// All profiles use the binning of the nominal data profile.
+class Pileup_Reweighting {
+   public:
+    explicit Pileup_Reweighting(const std::vector<std::string> &, std::string hist_name = "pileup");
+    Pileup_Table Sample_Table(const std::string &, const std::vector<std::string> &, const std::string &, const std::string &) const;
+    std::vector<Pileup_Table> File_Tables(const std::vector<std::string> &, const std::string &, const std::string &) const;
+
+   private:
+    std::vector<double> MC_Profile(TTree *) const;
+
+    Hist_Axis axis;
+    std::vector<std::vector<double>> data;  // normalized nominal, up and down profiles
+    std::string key;                        // identifies the data profiles in the cache
+};
+
+// normalize_profile scales the profile to unit area. The under- and
+// overflow bins (first and last entry) are dropped.
+std::vector<double> normalize_profile(const std::vector<double> &profile) {
+    std::vector<double> normalized(profile.begin() + 1, profile.end() - 1);
+    double sum(0.);
+    for (auto content : normalized) {
+        sum += content;
+    }
+    for (auto &content : normalized) {
+        content = sum > 0 ? content / sum : 0.;
+    }
+    return normalized;
+}
+
+// The Pileup_Reweighting constructor reads the histogram hist_name
+// from the nominal, up and down data pileup files. Throws if a
+// file can't be read or the binnings don't match.
+Pileup_Reweighting::Pileup_Reweighting(const std::vector<std::string> &data_files, std::string hist_name) {
+    if (data_files.size() != 3) {
+        throw std::invalid_argument("Pileup_Reweighting: need the nominal, up and down data profiles");
+    }
+    key = "pileup " + hist_name;
+    for (auto &file_name : data_files) {
+        auto fin = std::unique_ptr<TFile>(TFile::Open(file_name.c_str(), "READ"));
+        if (fin == nullptr || fin->IsZombie()) {
+            throw std::invalid_argument("Pileup_Reweighting: unable to open " + file_name);
+        }
+        auto hist = dynamic_cast<TH1 *>(fin->Get(hist_name.c_str()));
+        if (hist == nullptr) {
+            throw std::invalid_argument("Pileup_Reweighting: no histogram " + hist_name + " in " + file_name);
+        }
+        Hist_Axis hist_axis{hist->GetNbinsX(), hist->GetXaxis()->GetXmin(), hist->GetXaxis()->GetXmax()};
+        if (data.empty()) {
+            axis = hist_axis;
+        } else if (hist_axis.nbins != axis.nbins || hist_axis.low != axis.low || hist_axis.high != axis.high) {
+            throw std::invalid_argument("Pileup_Reweighting: binning of " + file_name + " doesn't match the nominal profile");
+        }
+        std::vector<double> profile;
+        for (auto bin = 0; bin <= axis.nbins + 1; bin++) {
+            profile.push_back(hist->GetBinContent(bin));
+        }
+        data.push_back(normalize_profile(profile));
+        key += " " + file_name;
+        fin->Close();
+    }
+}
+
+// Sample_Table returns the pileup table of one sample. The table is
+// read from cache_dir if it was built before from the same data
+// profiles, files and number of events. Otherwise, it is built from
+// the MC profile of the sample and written to cache_dir as
+// <sample>_pileup_<hash of the files>.txt, so jobs over different parts
+// of a sample don't overwrite each other's table. Bins without any
+// simulated events get a weight of 0.
+Pileup_Table Pileup_Reweighting::Sample_Table(const std::string &sample, const std::vector<std::string> &files, const std::string &tree_name,
+                                              const std::string &cache_dir) const {
+    auto chain = build_chain(files, tree_name);
+    auto sample_key = key + " files";
+    for (auto &file : files) {
+        sample_key += " " + file;
+    }
+    sample_key += " entries " + std::to_string(chain->GetEntries());
+    std::stringstream cache_name;
+    cache_name << cache_dir << "/" << sample << "_pileup_" << std::hex << std::hash<std::string>()(sample_key) << ".txt";
+    Pileup_Table table;
+    if (table.Read(cache_name.str(), sample_key)) {
+        return table;
+    }
+
+    auto mc = normalize_profile(MC_Profile(chain.get()));
+    std::vector<double> weights;
+    for (auto bin = 0; bin < axis.nbins; bin++) {
+        for (auto &profile : data) {
+            weights.push_back(mc[bin] > 0 ? profile[bin] / mc[bin] : 0.);
+        }
+    }
+    table = Pileup_Table(axis, weights);
+    table.Write(cache_name.str(), sample_key);
+    return table;
+}
+
+// File_Tables returns the pileup table of every file, in the same
+// order as files. Files of the same sample share one table.
+std::vector<Pileup_Table> Pileup_Reweighting::File_Tables(const std::vector<std::string> &files, const std::string &tree_name,
+                                                          const std::string &cache_dir) const {
+    std::map<std::string, std::vector<std::string>> sample_files;
+    for (auto &file : files) {
+        sample_files[sample_name(file)].push_back(file);
+    }
+    std::map<std::string, Pileup_Table> tables;
+    for (auto &sample : sample_files) {
+        tables[sample.first] = Sample_Table(sample.first, sample.second, tree_name, cache_dir);
+    }
+    std::vector<Pileup_Table> file_tables;
+    for (auto &file : files) {
+        file_tables.push_back(tables.at(sample_name(file)));
+    }
+    return file_tables;
+}
+
+// MC_Profile fills the in-time true pileup of every event in the
+// tree into the data binning. Only puBX and puTrue are read. Like
+// Event_Factory, events without an in-time bunch crossing get 0.
+std::vector<double> Pileup_Reweighting::MC_Profile(TTree *tree) const {
+    disable_all_branches(tree);
+    Branch_Registry registry(tree);
+    std::vector<int> *puBX(nullptr);
+    std::vector<float> *puTrue(nullptr);
+    registry.Bind("puBX", &puBX);
+    registry.Bind("puTrue", &puTrue);
+    std::vector<double> profile(axis.nbins + 2, 0.);
+    for (Long64_t i = 0; i < tree->GetEntries(); i++) {
+        registry.Load(tree->LoadTree(i));
+        float true_pu(0);
+        for (unsigned bx = 0; bx < puBX->size(); bx++) {
+            if (puBX->at(bx) == 0) {
+                true_pu = puTrue->at(bx);
+                break;
+            }
+        }
+        profile[axis.FindBin(true_pu)] += 1.;
+    }
+    return profile;
+}
+
+#endif  // INTERFACE_PILEUP_H_
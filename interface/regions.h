@@ -0,0 +1,61 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_REGIONS_H_
+#define INTERFACE_REGIONS_H_
+
+#include <string>
+#include <vector>
+#include "./json.hpp"
+
+// Region_Axes describes analysis regions built from a set of
+// yes/no axes, e.g. opposite/same sign, isolated/anti-isolated and
+// tau ID pass/fail. Each axis has a name and two labels. Bit i of a
+// region index is set when the event falls into the second label
+// of axis i, so an analyzer computes the index of its region with a
+// few bit operations instead of a tree of if/else blocks.
+//
+// The region name joins the labels of all axes with "_", skipping
+// empty labels. With the axes
+//     [["charge", "OS", "SS"], ["iso", "", "anti"], ["tau_id", "pass", "fail"]]
+// region 0 is "OS_pass" and region 7 (all bits set) is "SS_anti_fail".
+class Region_Axes {
+   public:
+    Region_Axes() {}
+    explicit Region_Axes(const nlohmann::json &);
+
+    // getters
+    unsigned size() const { return 1u << names.size(); }  // number of regions
+    bool empty() const { return names.empty(); }
+    const std::vector<std::string> &getAxisNames() const { return names; }
+    std::string getRegionName(unsigned) const;
+
+   private:
+    std::vector<std::string> names;
+    std::vector<std::string> first_labels, second_labels;
+};
+
+// Region_Axes reads the axes from the "axes" entry of a json
+// region block. Each axis is given as [name, first label, second label].
+Region_Axes::Region_Axes(const nlohmann::json &axes) {
+    for (auto &axis : axes) {
+        names.push_back(axis.at(0));
+        first_labels.push_back(axis.at(1));
+        second_labels.push_back(axis.at(2));
+    }
+}
+
+// getRegionName returns the name (directory) of the region with
+// the given index.
+std::string Region_Axes::getRegionName(unsigned region) const {
+    std::string name;
+    for (unsigned i = 0; i < names.size(); i++) {
+        auto &label = (region >> i) & 1 ? second_labels.at(i) : first_labels.at(i);
+        if (label.empty()) {
+            continue;
+        }
+        name += name.empty() ? label : "_" + label;
+    }
+    return name;
+}
+
+#endif  // INTERFACE_REGIONS_H_
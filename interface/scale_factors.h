@@ -0,0 +1,224 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_SCALE_FACTORS_H_
+#define INTERFACE_SCALE_FACTORS_H_
+
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "TFile.h"
+#include "TH1.h"
+
+// Correction_Axis holds the bin edges of one axis of a correction
+// map, plus the bin centers used for interpolation.
+struct Correction_Axis {
+    std::vector<double> edges, centers;
+
+    int Find_Bin(double) const;
+    void Find_Neighbors(double, int *, double *) const;
+};
+
+// count_below returns the number of values in the sorted array
+// that are <= x. The loop has a fixed number of steps for a given
+// size and no data-dependent branches, so it compiles to conditional
+// moves instead of jumps.
+int count_below(const double *values, int n, double x) {
+    if (n == 0) {
+        return 0;
+    }
+    const double *base = values;
+    while (n > 1) {
+        int half = n / 2;
+        base = base[half] <= x ? base + half : base;
+        n -= half;
+    }
+    return (base - values) + (*base <= x);
+}
+
+// Find_Bin returns the bin (starting at 0) holding x. Values below
+// the first or above the last edge are clamped to the first or last
+// bin, so there is no under- or overflow.
+int Correction_Axis::Find_Bin(double x) const {
+    // only the inner edges decide the bin
+    return count_below(edges.data() + 1, edges.size() - 2, x);
+}
+
+// Find_Neighbors finds the two bins whose centers surround x. lower
+// is set to the lower bin and frac to the weight of the upper bin.
+// Outside of the first and last bin centers the map is flat.
+void Correction_Axis::Find_Neighbors(double x, int *lower, double *frac) const {
+    int n = centers.size();
+    int above = count_below(centers.data(), n, x);
+    if (above == 0 || above == n) {
+        *lower = above == 0 ? 0 : n - 1;
+        *frac = 0.;
+        return;
+    }
+    *lower = above - 1;
+    *frac = (x - centers[*lower]) / (centers[*lower + 1] - centers[*lower]);
+}
+
+// Correction_Map is a 1D, 2D or 3D correction (e.g. a scale factor
+// as a function of pT and eta) copied out of a ROOT histogram into
+// flat arrays. The values are stored with the x bin changing fastest,
+// without under- or overflow bins. A Correction_Map is never changed
+// after it is loaded, so it can be shared by all threads.
+class Correction_Map {
+   public:
+    Correction_Map(const TH1 *, bool);
+    double Get(double x, double y = 0., double z = 0.) const;
+    template <typename T>
+    void Get_All(const std::vector<T> &, std::vector<double> *) const;
+    template <typename T>
+    void Get_All(const std::vector<T> &, const std::vector<T> &, std::vector<double> *) const;
+
+    // getters
+    int getDimension() const { return axes.size(); }
+    bool getInterpolate() const { return interpolate; }
+
+   private:
+    double Interpolate(const double *) const;
+
+    std::vector<Correction_Axis> axes;
+    std::vector<double> values;
+    std::vector<int> strides;  // distance between neighboring bins of each axis
+    bool interpolate;
+};
+
+// The Correction_Map constructor copies the edges and contents of
+// the histogram. With interpolate, Get interpolates linearly between
+// the bin centers (bilinear for 2D maps) instead of returning the
+// content of the bin.
+Correction_Map::Correction_Map(const TH1 *hist, bool _interpolate) : interpolate(_interpolate) {
+    auto hist_axes = {hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis()};
+    auto ndim = hist->GetDimension();
+    auto stride = 1;
+    for (auto hist_axis : hist_axes) {
+        if (static_cast<int>(axes.size()) == ndim) {
+            break;
+        }
+        Correction_Axis axis;
+        auto nbins = hist_axis->GetNbins();
+        for (auto bin = 1; bin <= nbins; bin++) {
+            axis.edges.push_back(hist_axis->GetBinLowEdge(bin));
+            axis.centers.push_back(0.5 * (hist_axis->GetBinLowEdge(bin) + hist_axis->GetBinUpEdge(bin)));
+        }
+        axis.edges.push_back(hist_axis->GetBinUpEdge(nbins));
+        axes.push_back(axis);
+        strides.push_back(stride);
+        stride *= nbins;
+    }
+
+    values.resize(stride);
+    auto nx = axes.at(0).centers.size();
+    auto ny = ndim > 1 ? axes.at(1).centers.size() : 1;
+    auto nz = ndim > 2 ? axes.at(2).centers.size() : 1;
+    for (unsigned iz = 0; iz < nz; iz++) {
+        for (unsigned iy = 0; iy < ny; iy++) {
+            for (unsigned ix = 0; ix < nx; ix++) {
+                values[ix + nx * (iy + ny * iz)] = hist->GetBinContent(ix + 1, ndim > 1 ? iy + 1 : 0, ndim > 2 ? iz + 1 : 0);
+            }
+        }
+    }
+}
+
+// Get returns the correction at the given point. Unused coordinates
+// of 1D and 2D maps are ignored. Points outside of the map get the
+// value of the closest bin.
+double Correction_Map::Get(double x, double y, double z) const {
+    double point[3] = {x, y, z};
+    if (interpolate) {
+        return Interpolate(point);
+    }
+    auto idx = 0;
+    for (unsigned i = 0; i < axes.size(); i++) {
+        idx += strides[i] * axes[i].Find_Bin(point[i]);
+    }
+    return values[idx];
+}
+
+// Interpolate combines the values of the 2^ndim bins around the point,
+// weighted by the distance to their centers.
+double Correction_Map::Interpolate(const double *point) const {
+    int lower[3];
+    double frac[3];
+    for (unsigned i = 0; i < axes.size(); i++) {
+        axes[i].Find_Neighbors(point[i], &lower[i], &frac[i]);
+    }
+    double result(0.);
+    for (unsigned corner = 0; corner < (1u << axes.size()); corner++) {
+        double weight(1.);
+        auto idx = 0;
+        for (unsigned i = 0; i < axes.size(); i++) {
+            auto upper = (corner >> i) & 1;
+            weight *= upper ? frac[i] : 1. - frac[i];
+            idx += strides[i] * (lower[i] + (upper && frac[i] > 0 ? 1 : 0));
+        }
+        result += weight * values[idx];
+    }
+    return result;
+}
+
+// Get_All looks up a 1D correction for every value of x, for example
+// the pT column of a factory. The results are stored in output.
+template <typename T>
+void Correction_Map::Get_All(const std::vector<T> &x, std::vector<double> *output) const {
+    output->resize(x.size());
+    for (unsigned i = 0; i < x.size(); i++) {
+        (*output)[i] = Get(x[i]);
+    }
+}
+
+// Get_All looks up a 2D correction for every pair of values of x and y.
+template <typename T>
+void Correction_Map::Get_All(const std::vector<T> &x, const std::vector<T> &y, std::vector<double> *output) const {
+    output->resize(x.size());
+    for (unsigned i = 0; i < x.size(); i++) {
+        (*output)[i] = Get(x[i], y.at(i));
+    }
+}
+
+// Scale_Factors loads all correction maps used by an analyzer once
+// at startup. Analyzers get a reference to each map with getMap
+// before the event loop. Only the flat arrays are kept, the ROOT
+// files are closed right after loading.
+class Scale_Factors {
+   public:
+    const Correction_Map &Load(std::string, std::string, std::string, bool interpolate = false);
+
+    // getters
+    const Correction_Map &getMap(std::string) const;
+
+   private:
+    std::map<std::string, std::shared_ptr<Correction_Map>> maps;
+};
+
+// Load reads the histogram hist_name from file_name and stores it
+// under name. Throws if the file or histogram can't be read.
+const Correction_Map &Scale_Factors::Load(std::string name, std::string file_name, std::string hist_name, bool interpolate) {
+    auto fin = std::unique_ptr<TFile>(TFile::Open(file_name.c_str(), "READ"));
+    if (fin == nullptr || fin->IsZombie()) {
+        throw std::invalid_argument("Scale_Factors: unable to open " + file_name);
+    }
+    auto hist = dynamic_cast<TH1 *>(fin->Get(hist_name.c_str()));
+    if (hist == nullptr) {
+        throw std::invalid_argument("Scale_Factors: no histogram " + hist_name + " in " + file_name);
+    }
+    maps[name] = std::make_shared<Correction_Map>(hist, interpolate);
+    fin->Close();
+    return *maps.at(name);
+}
+
+// getMap returns the correction map stored under name. Throws if
+// nothing was loaded with that name.
+const Correction_Map &Scale_Factors::getMap(std::string name) const {
+    auto map = maps.find(name);
+    if (map == maps.end()) {
+        throw std::invalid_argument("Scale_Factors: no correction map named " + name);
+    }
+    return *map->second;
+}
+
+#endif  // INTERFACE_SCALE_FACTORS_H_
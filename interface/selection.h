@@ -0,0 +1,90 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_SELECTION_H_
+#define INTERFACE_SELECTION_H_
+
+#include <vector>
+#include "./collection.h"
+
+// Selection picks objects out of a factory's collection
+// without copying them. Only the indices of the selected
+// objects are stored, so a Selection is only valid until the
+// factory runs again. The index storage is kept between events,
+// meaning a Selection owned by the event loop stops allocating
+// memory once it has seen the largest event.
+template <typename T>
+class Selection {
+   public:
+    class const_iterator;
+
+    Selection() : collection(nullptr) {}
+    template <typename Predicate>
+    void Select(const Collection<T> &, Predicate);
+    void Reset(const Collection<T> &);
+    void Add(unsigned idx) { indices.push_back(idx); }
+
+    // getters
+    unsigned size() const { return indices.size(); }
+    bool empty() const { return indices.empty(); }
+    T at(unsigned i) const { return collection->at(indices.at(i)); }
+    T operator[](unsigned i) const { return (*collection)[indices[i]]; }
+    const std::vector<unsigned> &getIndices() const { return indices; }  // positions in the collection
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, indices.size()); }
+
+   private:
+    const Collection<T> *collection;
+    std::vector<unsigned> indices;
+};
+
+// const_iterator lets a Selection be used in a range-based
+// for loop the same way as the original collection.
+template <typename T>
+class Selection<T>::const_iterator {
+   public:
+    const_iterator(const Selection<T> *_selection, unsigned _pos) : selection(_selection), pos(_pos) { update(); }
+    const T &operator*() const { return current; }
+    const T *operator->() const { return &current; }
+    const_iterator &operator++() {
+        ++pos;
+        update();
+        return *this;
+    }
+    bool operator!=(const const_iterator &other) const { return pos != other.pos; }
+    bool operator==(const const_iterator &other) const { return pos == other.pos; }
+
+   private:
+    void update() {
+        if (pos < selection->size()) {
+            current = (*selection)[pos];
+        }
+    }
+
+    const Selection<T> *selection;
+    unsigned pos;
+    T current;
+};
+
+// Select clears the Selection and keeps every object in the
+// collection for which pass(object) is true. The order of the
+// collection (decreasing pT for all factories) is preserved.
+template <typename T>
+template <typename Predicate>
+void Selection<T>::Select(const Collection<T> &objects, Predicate pass) {
+    Reset(objects);
+    for (unsigned i = 0; i < objects.size(); i++) {
+        if (pass(objects[i])) {
+            indices.push_back(i);
+        }
+    }
+}
+
+// Reset clears the Selection and points it to a new collection.
+// Objects can then be added by index with Add.
+template <typename T>
+void Selection<T>::Reset(const Collection<T> &objects) {
+    collection = &objects;
+    indices.clear();
+}
+
+#endif  // INTERFACE_SELECTION_H_
@@ -0,0 +1,170 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_SKIM_H_
+#define INTERFACE_SKIM_H_
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "./event_view.h"
+#include "./json.hpp"
+#include "./pairing.h"
+#include "./selection.h"
+#include "./util.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TTree.h"
+
+// Skim_Settings controls how a skim is written. compression uses the
+// ROOT convention 100 * algorithm + level (e.g. 101 for zlib level 1,
+// 404 for LZ4 level 4, 207 for LZMA level 7). LZ4 is the fastest to
+// read back, which is what a skim is made for. auto_flush is the
+// number of compressed bytes per cluster.
+struct Skim_Settings {
+    int compression;
+    int basket_size;
+    Long64_t auto_flush;
+};
+
+// Mt_Skim_Selection is the "Skim Selection" of the mu+tau channel
+// (docs/ztt-sf-measurement.md). All cuts are read from a json config
+//     {
+//         "met": 75,
+//         "muon": {"pt": 30, "eta": 2.4},
+//         "tau": {"pt": 20, "eta": 2.3},
+//         "delta_r": [0.4, 0.8],
+//         "mt": 40
+//     }
+// An event passes with MET above "met" and at least one mu/tau pair
+// inside the DeltaR window. The transverse mass of the muon of the
+// highest pT pair and the MET has to be below "mt".
+class Mt_Skim_Selection {
+   public:
+    explicit Mt_Skim_Selection(const nlohmann::json &);
+    bool Pass(Event_View *);
+
+   private:
+    double met, muon_pt, muon_eta, tau_pt, tau_eta, max_mt;
+    Selection<Muon> muons;
+    Selection<Boosted> taus;
+    Pair_Finder mu_tau_pairs;
+};
+
+// Mt_Skim_Selection reads the cuts from the json config. Throws if
+// any cut is missing, so a typo doesn't silently loosen the skim.
+Mt_Skim_Selection::Mt_Skim_Selection(const nlohmann::json &cuts)
+    : met(cuts.at("met")),
+      muon_pt(cuts.at("muon").at("pt")),
+      muon_eta(cuts.at("muon").at("eta")),
+      tau_pt(cuts.at("tau").at("pt")),
+      tau_eta(cuts.at("tau").at("eta")),
+      max_mt(cuts.at("mt")) {
+    mu_tau_pairs.DeltaR_Window(cuts.at("delta_r").at(0), cuts.at("delta_r").at(1)).Rank(highest_pt);
+}
+
+// Pass returns true if the current event passes the skim selection.
+// The cheapest cuts come first, so most events are rejected before
+// any object branches are read.
+bool Mt_Skim_Selection::Pass(Event_View *view) {
+    auto MET = view->getEvent().getMET();
+    if (MET.Pt() <= met) {
+        return false;
+    }
+
+    auto &all_muons = view->getMuons().getMuons();
+    muons.Reset(all_muons);
+    for (unsigned i = 0; i < all_muons.size(); i++) {
+        if (all_muons.at(i).getPt() > muon_pt && fabs(all_muons.at(i).getEta()) < muon_eta) {
+            muons.Add(i);
+        }
+    }
+    if (muons.size() == 0) {
+        return false;
+    }
+
+    auto &all_taus = view->getTaus().getTaus();
+    taus.Reset(all_taus);
+    for (unsigned i = 0; i < all_taus.size(); i++) {
+        if (all_taus.at(i).getPt() > tau_pt && fabs(all_taus.at(i).getEta()) < tau_eta) {
+            taus.Add(i);
+        }
+    }
+
+    auto &pairs = mu_tau_pairs.Find(muons, taus);
+    if (pairs.size() == 0) {
+        return false;
+    }
+    auto muon = muons.at(pairs.front().first).getP4();
+    return transverse_mass(muon, MET) < max_mt;
+}
+
+// Skim_Writer copies selected entries of a tree to a new file. Only
+// the active branches are copied, which are the branches registered by
+// the factories once disable_all_branches has been called. The skim
+// keeps the directory and name of the input tree, so it can be read
+// back by any analyzer without changing the -t option.
+//
+// A Skim_Writer belongs to a single thread and the tree it was given.
+class Skim_Writer {
+   public:
+    Skim_Writer(TTree *, const std::string &, const std::string &, const Skim_Settings &);
+    void Fill(Long64_t);
+    void Write(TObject *);
+    void Close();
+
+    // getters
+    Long64_t getEntries() const { return entries; }
+
+   private:
+    TTree *tree;
+    std::unique_ptr<TFile> fout;
+    TTree *skim;  // owned by fout
+    Long64_t entries;
+};
+
+// Skim_Writer creates the output file with the requested compression
+// and an empty copy of the tree with only the active branches.
+Skim_Writer::Skim_Writer(TTree *_tree, const std::string &file_name, const std::string &tree_name, const Skim_Settings &settings)
+    : tree(_tree), fout(new TFile(file_name.c_str(), "RECREATE")), skim(nullptr), entries(0) {
+    if (fout->IsZombie()) {
+        throw std::invalid_argument("Skim_Writer: unable to create " + file_name);
+    }
+    fout->SetCompressionSettings(settings.compression);
+    auto slash = tree_name.rfind("/");
+    if (slash != std::string::npos) {
+        fout->mkdir(tree_name.substr(0, slash).c_str());
+        fout->cd(tree_name.substr(0, slash).c_str());
+    }
+    if (tree->GetTree() == nullptr) {
+        tree->LoadTree(0);  // a TChain needs an open file to be cloned
+    }
+    skim = tree->CloneTree(0);
+    skim->SetBasketSize("*", settings.basket_size);
+    skim->SetAutoFlush(-settings.auto_flush);
+}
+
+// Fill reads all active branches of entry i (counted over the whole
+// chain) and writes the entry to the skim. Branches already read by
+// the factories come from the basket cache.
+void Skim_Writer::Fill(Long64_t i) {
+    tree->GetEntry(i);
+    skim->Fill();
+    entries++;
+}
+
+// Write stores an object (e.g. the summed hcount histogram) in the
+// root directory of the skim file.
+void Skim_Writer::Write(TObject *object) {
+    fout->cd();
+    object->Write();
+}
+
+// Close writes the skimmed tree and closes the file.
+void Skim_Writer::Close() {
+    skim->GetDirectory()->cd();
+    skim->Write();
+    fout->Close();
+}
+
+#endif  // INTERFACE_SKIM_H_
@@ -7,70 +7,76 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "./branch_registry.h"
+#include "./collection.h"
+#include "./p4.h"
 #include "./util.h"
-#include "TLorentzVector.h"
 #include "TTree.h"
 
 class Tau;  // Tau combines all tau information
-typedef std::vector<Tau> VTau;
-
-// Tau combines all tau related information along with
-// creating the tau 4-vector. Helper functions are provided
-// to access properties of the taus. These properties cannot
-// be updated.
+typedef Collection<Tau> VTau;
+
+// Tau gives access to all tau related information along with
+// creating the tau 4-vector. The information is stored in the
+// Columns of a VTau and the Tau only points to its row, so it
+// is cheap to copy. All ID decisions are packed into a single word
+// per tau (see tau_id_bit). Helper functions are provided to access
+// properties of the taus. These properties cannot be updated.
 class Tau {
-    friend class Tau_Factory;  // Tau_Factory constructs individual Taus
-
    public:
-    Tau(Float_t _pt, Float_t _eta, Float_t _phi, Float_t _m) { this->p4.SetPtEtaPhiM(_pt, _eta, _phi, _m); }
-    Tau() { this->p4.SetPtEtaPhiE(0, 0, 0, 0); }
+    // Columns holds every tau variable for all taus in the event.
+    struct Columns {
+        std::vector<Float_t> pt, eta, phi, mass, Charge, Dxy, dz, dxy;
+        std::vector<Int_t> DecayMode;
+        std::vector<UShort_t> IDs;
+        void clear();
+    };
+
+    Tau() : columns(nullptr), row(0) {}
+    Tau(const Columns *_columns, unsigned _row) : columns(_columns), row(_row) {}
 
     // getters
-    TLorentzVector getP4() { return p4; }
-    Float_t getPt() { return p4.Pt(); }
-    Float_t getEta() { return p4.Eta(); }
-    Float_t getPhi() { return p4.Phi(); }
-    Float_t getMass() { return p4.M(); }
-    Bool_t getIso(working_point);
-    Bool_t getDiscByDM(bool);
-    Bool_t getEleRejection(working_point);
-    Bool_t getMuRejection(working_point);
-    Bool_t getCombinedIsolationDeltaBetaCorr3Hits(working_point);
-    Int_t getDecayMode() { return DecayMode; }
-    Float_t getCharge() { return Charge; }
-    Float_t getDxy() { return Dxy; }
-    Float_t getDZ() { return dz; }
-    Float_t getDXY() { return dxy; }
+    PtEtaPhiM getP4() const { return PtEtaPhiM(getPt(), getEta(), getPhi(), getMass()); }
+    Float_t getPt() const { return columns->pt[row]; }
+    Float_t getEta() const { return columns->eta[row]; }
+    Float_t getPhi() const { return columns->phi[row]; }
+    Float_t getMass() const { return columns->mass[row]; }
+    Bool_t getIso(working_point) const;
+    Bool_t getDiscByDM(bool) const;
+    Bool_t getEleRejection(working_point) const;
+    Bool_t getMuRejection(working_point) const;
+    Bool_t getCombinedIsolationDeltaBetaCorr3Hits(working_point) const;
+    Int_t getDecayMode() const { return columns->DecayMode[row]; }
+    Float_t getCharge() const { return columns->Charge[row]; }
+    Float_t getDxy() const { return columns->Dxy[row]; }
+    Float_t getDZ() const { return columns->dz[row]; }
+    Float_t getDXY() const { return columns->dxy[row]; }
 
    private:
-    // these should never be modified once read from the TTree
-    TLorentzVector p4;
-    Bool_t pass_vloose_iso, pass_loose_iso, pass_medium_iso, pass_tight_iso, pass_vtight_iso;
-
-    Bool_t pfTausDiscriminationByDecayModeFinding, pfTausDiscriminationByDecayModeFindingNewDMs, ByMVA6VLooseElectronRejection,
-        ByMVA6LooseElectronRejection, ByMVA6MediumElectronRejection, ByMVA6TightElectronRejection, ByMVA6VTightElectronRejection,
-        ByLooseMuonRejection3, ByTightMuonRejection3;
-
-    Int_t DecayMode;
+    Bool_t hasID(int bit) const { return (columns->IDs[row] >> bit & 1) == 1; }
 
-    Float_t Charge, Dxy, Mass, dz, dxy;
+    const Columns *columns;
+    unsigned row;
 };
 
 // Tau_Factory reads from the TTree and constructs
 // individual Tau objects. The Tau_Factory holds the
-// list of taus, but can provided a shared_ptr to the
-// list.
+// list of taus. The list is handed out by
+// reference and is only valid until the next Run_Factory.
 class Tau_Factory {
    public:
     explicit Tau_Factory(TTree *, std::string);
     void Run_Factory();
+    Int_t Load(Long64_t entry) { return registry.Load(entry); }  // read only this factory's branches
 
     // getters
+    const std::vector<std::string> &getBranches() { return registry.getNames(); }  // branches read by this factory
     Int_t getNTotalTau() { return nTau; }     // nTaus directly from TTree
     Int_t getNGoodTau() { return nGoodTau; }  // nTaus passing preselection
-    std::shared_ptr<VTau> getTaus() { return std::make_shared<VTau>(taus); }
+    const VTau &getTaus() const { return taus; }
 
    private:
+    Branch_Registry registry;
     Int_t nTau, nGoodTau;
     VTau taus;
 
@@ -89,7 +95,8 @@ class Tau_Factory {
 // The type of tau isolation can be chosen and defaults to
 // MVArun2v1DBOldDMwLT.
 Tau_Factory::Tau_Factory(TTree *tree, std::string isoType = "IsolationMVArun2v1DBoldDMwLT")
-    : tauPt(nullptr),
+    : registry(tree),
+      tauPt(nullptr),
       tauEta(nullptr),
       tauPhi(nullptr),
       tauMass(nullptr),
@@ -117,89 +124,96 @@ Tau_Factory::Tau_Factory(TTree *tree, std::string isoType = "IsolationMVArun2v1D
       tauDxy(nullptr),
       taudz(nullptr),
       taudxy(nullptr) {
-    tree->SetBranchAddress("nTau", &nTau);
-    tree->SetBranchAddress("tauPt", &tauPt);
-    tree->SetBranchAddress("tauEta", &tauEta);
-    tree->SetBranchAddress("tauPhi", &tauPhi);
-    tree->SetBranchAddress("tauMass", &tauMass);
-    tree->SetBranchAddress(("tauBy" + isoType + "raw").c_str(), &iso);
-    tree->SetBranchAddress(("tauByVLoose" + isoType).c_str(), &pass_vloose_iso);
-    tree->SetBranchAddress(("tauByLoose" + isoType).c_str(), &pass_loose_iso);
-    tree->SetBranchAddress(("tauByMedium" + isoType).c_str(), &pass_medium_iso);
-    tree->SetBranchAddress(("tauByTight" + isoType).c_str(), &pass_tight_iso);
-    tree->SetBranchAddress(("tauByVTight" + isoType).c_str(), &pass_vtight_iso);
-    tree->SetBranchAddress("taupfTausDiscriminationByDecayModeFinding", &taupfTausDiscriminationByDecayModeFinding);
-    tree->SetBranchAddress("taupfTausDiscriminationByDecayModeFindingNewDMs", &taupfTausDiscriminationByDecayModeFindingNewDMs);
-    tree->SetBranchAddress("tauByMVA6VLooseElectronRejection", &tauByMVA6VLooseElectronRejection);
-    tree->SetBranchAddress("tauByMVA6LooseElectronRejection", &tauByMVA6LooseElectronRejection);
-    tree->SetBranchAddress("tauByMVA6MediumElectronRejection", &tauByMVA6MediumElectronRejection);
-    tree->SetBranchAddress("tauByMVA6TightElectronRejection", &tauByMVA6TightElectronRejection);
-    tree->SetBranchAddress("tauByMVA6VTightElectronRejection", &tauByMVA6VTightElectronRejection);
-    tree->SetBranchAddress("tauByLooseMuonRejection3", &tauByLooseMuonRejection3);
-    tree->SetBranchAddress("tauByTightMuonRejection3", &tauByTightMuonRejection3);
-    tree->SetBranchAddress("tauDecayMode", &tauDecayMode);
-    tree->SetBranchAddress("tauCharge", &tauCharge);
-    tree->SetBranchAddress("tauP", &tauP);
-    tree->SetBranchAddress("tauPx", &tauPx);
-    tree->SetBranchAddress("tauPy", &tauPy);
-    tree->SetBranchAddress("tauPz", &tauPz);
-    tree->SetBranchAddress("tauDxy", &tauDxy);
-    tree->SetBranchAddress("taudz", &taudz);
-    tree->SetBranchAddress("taudxy", &taudxy);
+    registry.Bind("nTau", &nTau);
+    registry.Bind("tauPt", &tauPt);
+    registry.Bind("tauEta", &tauEta);
+    registry.Bind("tauPhi", &tauPhi);
+    registry.Bind("tauMass", &tauMass);
+    registry.Bind(("tauBy" + isoType + "raw").c_str(), &iso);
+    registry.Bind(("tauByVLoose" + isoType).c_str(), &pass_vloose_iso);
+    registry.Bind(("tauByLoose" + isoType).c_str(), &pass_loose_iso);
+    registry.Bind(("tauByMedium" + isoType).c_str(), &pass_medium_iso);
+    registry.Bind(("tauByTight" + isoType).c_str(), &pass_tight_iso);
+    registry.Bind(("tauByVTight" + isoType).c_str(), &pass_vtight_iso);
+    registry.Bind("taupfTausDiscriminationByDecayModeFinding", &taupfTausDiscriminationByDecayModeFinding);
+    registry.Bind("taupfTausDiscriminationByDecayModeFindingNewDMs", &taupfTausDiscriminationByDecayModeFindingNewDMs);
+    registry.Bind("tauByMVA6VLooseElectronRejection", &tauByMVA6VLooseElectronRejection);
+    registry.Bind("tauByMVA6LooseElectronRejection", &tauByMVA6LooseElectronRejection);
+    registry.Bind("tauByMVA6MediumElectronRejection", &tauByMVA6MediumElectronRejection);
+    registry.Bind("tauByMVA6TightElectronRejection", &tauByMVA6TightElectronRejection);
+    registry.Bind("tauByMVA6VTightElectronRejection", &tauByMVA6VTightElectronRejection);
+    registry.Bind("tauByLooseMuonRejection3", &tauByLooseMuonRejection3);
+    registry.Bind("tauByTightMuonRejection3", &tauByTightMuonRejection3);
+    registry.Bind("tauDecayMode", &tauDecayMode);
+    registry.Bind("tauCharge", &tauCharge);
+    registry.Bind("tauP", &tauP);
+    registry.Bind("tauPx", &tauPx);
+    registry.Bind("tauPy", &tauPy);
+    registry.Bind("tauPz", &tauPz);
+    registry.Bind("tauDxy", &tauDxy);
+    registry.Bind("taudz", &taudz);
+    registry.Bind("taudxy", &taudxy);
 }
 
-// Called once per event to construct the Taus. A basic
-// preselection is applied to all taus. All Taus passing
-// preselection are sorted by pT and stored.
+// Called once per event to fill the tau columns. A basic
+// preselection is applied to all taus. All taus passing
+// preselection are stored and ordered by pT.
 void Tau_Factory::Run_Factory() {
-    taus.clear();
+    auto &columns = taus.Reset();
     for (auto i = 0; i < nTau; i++) {
         // baseline/default selection
         if (tauPt->at(i) < 20 || tauEta->at(i) > 2.3 || !pass_vloose_iso->at(i)) {
             continue;
         }
-        auto tau = Tau(tauPt->at(i), tauEta->at(i), tauPhi->at(i), tauMass->at(i));  // build the tau
-        tau.pass_vloose_iso = pass_vloose_iso->at(i);
-        tau.pass_loose_iso = pass_loose_iso->at(i);
-        tau.pass_medium_iso = pass_medium_iso->at(i);
-        tau.pass_tight_iso = pass_tight_iso->at(i);
-        tau.pass_vtight_iso = pass_vtight_iso->at(i);
-        tau.pfTausDiscriminationByDecayModeFinding = taupfTausDiscriminationByDecayModeFinding->at(i);
-        tau.pfTausDiscriminationByDecayModeFindingNewDMs = taupfTausDiscriminationByDecayModeFindingNewDMs->at(i);
-        tau.ByMVA6VLooseElectronRejection = tauByMVA6VLooseElectronRejection->at(i);
-        tau.ByMVA6LooseElectronRejection = tauByMVA6LooseElectronRejection->at(i);
-        tau.ByMVA6MediumElectronRejection = tauByMVA6MediumElectronRejection->at(i);
-        tau.ByMVA6TightElectronRejection = tauByMVA6TightElectronRejection->at(i);
-        tau.ByMVA6VTightElectronRejection = tauByMVA6VTightElectronRejection->at(i);
-        tau.ByLooseMuonRejection3 = tauByLooseMuonRejection3->at(i);
-        tau.ByTightMuonRejection3 = tauByTightMuonRejection3->at(i);
-        tau.DecayMode = tauDecayMode->at(i);
-        tau.Charge = tauCharge->at(i);
-        tau.Dxy = tauDxy->at(i);
-        tau.dz = taudz->at(i);
-        tau.dxy = taudxy->at(i);
-        taus.push_back(tau);
+        columns.pt.push_back(tauPt->at(i));
+        columns.eta.push_back(tauEta->at(i));
+        columns.phi.push_back(tauPhi->at(i));
+        columns.mass.push_back(tauMass->at(i));
+        columns.Charge.push_back(tauCharge->at(i));
+        columns.Dxy.push_back(tauDxy->at(i));
+        columns.dz.push_back(taudz->at(i));
+        columns.dxy.push_back(taudxy->at(i));
+        columns.DecayMode.push_back(tauDecayMode->at(i));
+
+        // pack all ID decisions
+        UShort_t ids(0);
+        ids |= pass_vloose_iso->at(i) << (iso_bit + vloose);
+        ids |= pass_loose_iso->at(i) << (iso_bit + loose);
+        ids |= pass_medium_iso->at(i) << (iso_bit + medium);
+        ids |= pass_tight_iso->at(i) << (iso_bit + tight);
+        ids |= pass_vtight_iso->at(i) << (iso_bit + vtight);
+        ids |= tauByMVA6VLooseElectronRejection->at(i) << (ele_rejection_bit + vloose);
+        ids |= tauByMVA6LooseElectronRejection->at(i) << (ele_rejection_bit + loose);
+        ids |= tauByMVA6MediumElectronRejection->at(i) << (ele_rejection_bit + medium);
+        ids |= tauByMVA6TightElectronRejection->at(i) << (ele_rejection_bit + tight);
+        ids |= tauByMVA6VTightElectronRejection->at(i) << (ele_rejection_bit + vtight);
+        ids |= tauByLooseMuonRejection3->at(i) << loose_mu_rejection_bit;
+        ids |= tauByTightMuonRejection3->at(i) << tight_mu_rejection_bit;
+        ids |= taupfTausDiscriminationByDecayModeFinding->at(i) << dm_finding_bit;
+        ids |= taupfTausDiscriminationByDecayModeFindingNewDMs->at(i) << new_dm_finding_bit;
+        columns.IDs.push_back(ids);
     }
 
     // sort by pT
-    std::sort(taus.begin(), taus.end(), [](Tau &p1, Tau &p2) -> bool { return p1.getPt() > p2.getPt(); });
+    taus.Sort();
     nGoodTau = taus.size();
 }
 
+// clear empties all columns while keeping their memory.
+void Tau::Columns::clear() {
+    for (auto column : {&pt, &eta, &phi, &mass, &Charge, &Dxy, &dz, &dxy}) {
+        column->clear();
+    }
+    DecayMode.clear();
+    IDs.clear();
+}
+
 // Check whether the tau passes isolation at
 // the provided working point. The type of isolation
 // is chosen in the Tau_Factory constructor.
-Bool_t Tau::getIso(working_point wp) {
-    if (wp == vloose) {
-        return pass_vloose_iso;
-    } else if (wp == loose) {
-        return pass_loose_iso;
-    } else if (wp == medium) {
-        return pass_medium_iso;
-    } else if (wp == tight) {
-        return pass_tight_iso;
-    } else if (wp == vtight) {
-        return pass_vtight_iso;
+Bool_t Tau::getIso(working_point wp) const {
+    if (wp >= vloose && wp <= vtight) {
+        return hasID(iso_bit + wp);
     }
     throw std::invalid_argument("Must use one of the provided tau isolation WPs");
 }
@@ -207,37 +221,29 @@ Bool_t Tau::getIso(working_point wp) {
 // Check whether the Tau passes decay mode finding.
 // New and old DMs are available with old being the
 // default option.
-Bool_t Tau::getDiscByDM(bool newDM = false) {
+Bool_t Tau::getDiscByDM(bool newDM = false) const {
     if (newDM) {
-        return pfTausDiscriminationByDecayModeFindingNewDMs;
+        return hasID(new_dm_finding_bit);
     }
-    return pfTausDiscriminationByDecayModeFinding;
+    return hasID(dm_finding_bit);
 }
 
 // Check whether the Tau passes electron rejection
 // at the requested working point.
-Bool_t Tau::getEleRejection(working_point wp) {
-    if (wp == vloose) {
-        return ByMVA6VLooseElectronRejection;
-    } else if (wp == loose) {
-        return ByMVA6LooseElectronRejection;
-    } else if (wp == medium) {
-        return ByMVA6MediumElectronRejection;
-    } else if (wp == tight) {
-        return ByMVA6TightElectronRejection;
-    } else if (wp == vtight) {
-        return ByMVA6VTightElectronRejection;
+Bool_t Tau::getEleRejection(working_point wp) const {
+    if (wp >= vloose && wp <= vtight) {
+        return hasID(ele_rejection_bit + wp);
     }
     throw std::invalid_argument("Must use one of the provided electron rejection WPs");
 }
 
 // Check whether the Tau passes muon rejection
 // at the requested working point.
-Bool_t Tau::getMuRejection(working_point wp) {
+Bool_t Tau::getMuRejection(working_point wp) const {
     if (wp == loose) {
-        return ByLooseMuonRejection3;
+        return hasID(loose_mu_rejection_bit);
     } else if (wp == tight) {
-        return ByTightMuonRejection3;
+        return hasID(tight_mu_rejection_bit);
     }
     throw std::invalid_argument("Muon rejection working point was neither Tight nor Loose");
 }
@@ -0,0 +1,96 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_TRIGGER_STUDY_H_
+#define INTERFACE_TRIGGER_STUDY_H_
+
+#include "./analyzer.h"
+#include "./event_view.h"
+#include "./hist_buffer.h"
+#include "./histManager.h"
+#include "./p4.h"
+#include "./pairing.h"
+#include "./triggers.h"
+
+// Trigger_Study counts the simulated Z->tautau->mutau events with a
+// boosted Z recoiling against a jet that fire every combination of a
+// list of trigger paths. It is registered as "trigger_study" and always
+// uses configs/trigger_study.json, where the paths are listed with the
+// histogram
+//     "triggers": {"type": "combinations", "paths": ["HLTJet[37]", "HLTJet[38]"]}
+// The paths are resolved in Begin, so a path missing from the trigger
+// menu stops the job before any event is processed.
+class Trigger_Study : public Analyzer {
+   public:
+    Trigger_Study() {
+        z_pairs.DeltaR_Window(0.02, 1.).Mass_Window(0., 65.).Charge(opposite_charge).Rank(closest_mass, 65.);
+    }
+    void Begin(const histManager &hists) {
+        triggers = hists.GetCombinations("triggers");
+        fired = trigger_menu().Compile_Pattern(triggers.paths);
+    }
+    void Process(Event_View *, Hist_Buffer *);
+
+   private:
+    Hist_Combinations triggers;  // handle of the trigger combination histogram
+    Trigger_Pattern fired;       // paths of the trigger histogram fired in an event
+    Pair_Finder z_pairs;         // mu/tau pairs making the Z candidate
+};
+
+REGISTER_ANALYZER_CONFIG(Trigger_Study, "trigger_study", "configs/trigger_study.json");
+
+// Process fills the pattern of fired paths of every selected event.
+// Only the generator-level particles are read up front. Everything
+// else is read once the event is known to be a mutau event.
+void Trigger_Study::Process(Event_View *view, Hist_Buffer *hists) {
+    auto &gen_graph = view->getGens().getGraph();
+
+    // only look at mutau channel
+    if (gen_graph.getNTauDecays(tau_to_muon) != 1) {
+        return;
+    }
+
+    auto &boosts = view->getTaus().getTaus();
+    if (boosts.size() < 2) {
+        return;
+    }
+    auto &jets = view->getJets().getJets();
+    auto &muons = view->getMuons().getMuons();
+
+    // get our Z boson. Pick the opposite-sign pair closest to the
+    // Z mass, but below 65 GeV
+    PtEtaPhiM z_boson, z_muon, z_tau;
+    auto &pairs = z_pairs.Find(muons, boosts);
+    if (pairs.size() > 0) {
+        z_muon = muons.at(pairs.front().first).getP4();
+        z_tau = boosts.at(pairs.front().second).getP4();
+        z_boson = z_muon + z_tau;
+    }
+
+    // make sure Z and high pT jet are back-to-back
+    if (jets.size() == 0 || jets.at(0).getP4().DeltaR(z_boson) < 2.5) {
+        return;
+    }
+
+    // make sure our lead muon is actually a muon
+    // same for the tau
+    bool is_real_muon(false), is_real_tau(false);
+    for (auto row : gen_graph.getParticles(13)) {
+        if (gen_graph.at(row).getP4().DeltaR(z_muon) < 0.5) {
+            is_real_muon = true;
+        }
+    }
+    for (auto row : gen_graph.getParticles(15)) {
+        if (gen_graph.at(row).getP4().DeltaR(z_tau) < 0.5) {
+            is_real_tau = true;
+        }
+    }
+    if (!is_real_muon || !is_real_tau) {
+        return;
+    }
+
+    // one fill per event, the OR of every combination of the
+    // triggers is found when the histogram is written
+    hists->Fill(triggers, fired.Get(view->getEvent()), view->getNormalization());
+}
+
+#endif  // INTERFACE_TRIGGER_STUDY_H_
@@ -0,0 +1,396 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_TRIGGERS_H_
+#define INTERFACE_TRIGGERS_H_
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./branch_registry.h"
+#include "./event_factory.h"
+#include "./event_loop.h"
+#include "./input_files.h"
+#include "./json.hpp"
+
+// Trigger_Bit is the position of one HLT path in the trigger words.
+struct Trigger_Bit {
+    trigger_word word;
+    int bit;
+};
+
+// Trigger_Masks holds one mask per trigger word, indexed by trigger_word.
+typedef std::array<ULong64_t, 3> Trigger_Masks;
+
+// Trigger_Expression is a compiled OR of ANDs of HLT paths. All paths
+// ORed on their own are merged into one mask per word, so a plain OR of
+// any number of paths costs three mask tests. Every AND term is one
+// mask per word which must be fully set. Expressions are made with
+// Trigger_Menu::Compile.
+class Trigger_Expression {
+   public:
+    Trigger_Expression() : any({{0, 0, 0}}) {}
+    bool Pass(Event_Factory &event) const {
+        Trigger_Masks words = {{event.getTriggerWord(lep_word), event.getTriggerWord(pho_word), event.getTriggerWord(jet_word)}};
+        return Pass(words);
+    }
+    bool Pass(const Trigger_Masks &) const;
+
+    // getters
+    std::string getKey() const;  // the masks as text, identifies the expression in caches
+
+   private:
+    friend class Trigger_Menu;
+    Trigger_Masks any;               // paths ORed on their own
+    std::vector<Trigger_Masks> all;  // AND terms
+};
+
+// Trigger_Pattern finds which of up to 32 trigger paths fired in an
+// event, as a bit pattern with bit i set for path i. Instead of testing
+// every path, each byte of a trigger word holding a requested path is
+// looked up in a table of 256 precomputed patterns, so N paths spread
+// over b bytes take b lookups. Patterns are made with
+// Trigger_Menu::Compile_Pattern.
+class Trigger_Pattern {
+   public:
+    unsigned Get(Event_Factory &event) const {
+        Trigger_Masks words = {{event.getTriggerWord(lep_word), event.getTriggerWord(pho_word), event.getTriggerWord(jet_word)}};
+        return Get(words);
+    }
+    unsigned Get(const Trigger_Masks &words) const {
+        unsigned pattern(0);
+        for (auto &table : tables) {
+            pattern |= table.patterns[(words[table.word] >> table.shift) & 0xff];
+        }
+        return pattern;
+    }
+
+   private:
+    friend class Trigger_Menu;
+    // Byte_Table maps the values of one byte of a trigger word to the
+    // paths they fire.
+    struct Byte_Table {
+        trigger_word word;
+        int shift;
+        std::array<unsigned, 256> patterns;
+    };
+    std::vector<Byte_Table> tables;
+};
+
+// Trigger_Menu maps HLT path names to their bit in the trigger words
+// of the ggNtuples. The paths are read from a json config
+//     {"paths": {"HLT_IsoMu24_v": {"word": "HLTEleMuX", "bit": 19}, ...}}
+// A path can also be given by its position without a name, e.g.
+// HLTJet[37]. Names are resolved once, when an expression is compiled,
+// so no strings are used per event.
+class Trigger_Menu {
+   public:
+    Trigger_Menu() {}
+    void Read(const std::string &);
+    Trigger_Bit Resolve(const std::string &) const;
+    Trigger_Expression Compile(const std::string &) const;
+    Trigger_Pattern Compile_Pattern(const std::vector<std::string> &) const;
+
+   private:
+    typedef std::vector<Trigger_Masks> Terms;  // OR of AND terms
+    Terms Parse_Or(const std::vector<std::string> &, unsigned *, const std::string &) const;
+    Terms Parse_And(const std::vector<std::string> &, unsigned *, const std::string &) const;
+    Terms Parse_Path(const std::vector<std::string> &, unsigned *, const std::string &) const;
+
+    std::map<std::string, Trigger_Bit> paths;
+};
+
+// trigger_menu returns the menu shared by the host and all analyzers.
+// The host reads it before any analyzer is created, so analyzers can
+// compile their triggers in Begin.
+Trigger_Menu &trigger_menu() {
+    static Trigger_Menu menu;
+    return menu;
+}
+
+// Pass returns true if the trigger words of an event pass the expression.
+bool Trigger_Expression::Pass(const Trigger_Masks &words) const {
+    if ((words[lep_word] & any[lep_word]) | (words[pho_word] & any[pho_word]) | (words[jet_word] & any[jet_word])) {
+        return true;
+    }
+    for (auto &term : all) {
+        if ((words[lep_word] & term[lep_word]) == term[lep_word] && (words[pho_word] & term[pho_word]) == term[pho_word] &&
+            (words[jet_word] & term[jet_word]) == term[jet_word]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// getKey writes all masks in hex.
+std::string Trigger_Expression::getKey() const {
+    std::stringstream key;
+    key << std::hex << any[lep_word] << "," << any[pho_word] << "," << any[jet_word];
+    for (auto &term : all) {
+        key << " " << term[lep_word] << "," << term[pho_word] << "," << term[jet_word];
+    }
+    return key.str();
+}
+
+// trigger_word_names are the names of the branches holding the words,
+// in the order of trigger_word.
+const std::vector<std::string> trigger_word_names = {"HLTEleMuX", "HLTPho", "HLTJet"};
+
+// parse_trigger_word returns the trigger_word of a branch name.
+// Throws for an unknown name.
+trigger_word parse_trigger_word(const std::string &name) {
+    for (unsigned i = 0; i < trigger_word_names.size(); i++) {
+        if (trigger_word_names.at(i) == name) {
+            return static_cast<trigger_word>(i);
+        }
+    }
+    throw std::invalid_argument("Trigger_Menu: unknown trigger word " + name);
+}
+
+// Read adds all paths of the json config to the menu. Throws if the
+// file can't be read or a path has an invalid word or bit.
+void Trigger_Menu::Read(const std::string &file_name) {
+    std::ifstream fin(file_name);
+    if (!fin.good()) {
+        throw std::invalid_argument("Trigger_Menu: unable to open " + file_name);
+    }
+    nlohmann::json config;
+    fin >> config;
+    auto &config_paths = config.at("paths");
+    for (auto path = config_paths.begin(); path != config_paths.end(); ++path) {
+        Trigger_Bit trigger{parse_trigger_word(path.value().at("word")), path.value().at("bit")};
+        if (trigger.bit < 0 || trigger.bit > 63) {
+            throw std::invalid_argument("Trigger_Menu: bit of " + path.key() + " is outside of 0 to 63");
+        }
+        paths[path.key()] = trigger;
+    }
+}
+
+// Resolve returns the bit of a named path or a path given as
+// word[bit]. Throws if the path is unknown.
+Trigger_Bit Trigger_Menu::Resolve(const std::string &name) const {
+    auto path = paths.find(name);
+    if (path != paths.end()) {
+        return path->second;
+    }
+    auto open = name.find("[");
+    if (open != std::string::npos && name.back() == ']' && open + 2 < name.size()) {
+        auto number = name.substr(open + 1, name.size() - open - 2);
+        if (number.find_first_not_of("0123456789") == std::string::npos && std::stoi(number) < 64) {
+            return Trigger_Bit{parse_trigger_word(name.substr(0, open)), std::stoi(number)};
+        }
+    }
+    throw std::invalid_argument("Trigger_Menu: unknown trigger path " + name);
+}
+
+// Compile turns an expression of paths, || (or), && (and) and
+// parentheses into a Trigger_Expression, e.g.
+//     HLT_Ele35_WPTight_Gsf_v || (HLT_IsoMu24_v && HLTJet[37])
+// && binds stronger than ||. Throws for a malformed expression.
+Trigger_Expression Trigger_Menu::Compile(const std::string &expression) const {
+    std::vector<std::string> tokens;
+    for (unsigned i = 0; i < expression.size();) {
+        auto c = expression[i];
+        if (std::isspace(c)) {
+            i++;
+        } else if (c == '(' || c == ')') {
+            tokens.push_back(std::string(1, c));
+            i++;
+        } else if ((c == '|' || c == '&') && i + 1 < expression.size() && expression[i + 1] == c) {
+            tokens.push_back(expression.substr(i, 2));
+            i += 2;
+        } else if (std::isalnum(c) || c == '_' || c == '[') {
+            auto end = i;
+            while (end < expression.size() && (std::isalnum(expression[end]) || expression[end] == '_' || expression[end] == '[' || expression[end] == ']')) {
+                end++;
+            }
+            tokens.push_back(expression.substr(i, end - i));
+            i = end;
+        } else {
+            throw std::invalid_argument("Trigger_Menu: unexpected '" + std::string(1, c) + "' in " + expression);
+        }
+    }
+
+    unsigned pos(0);
+    auto terms = Parse_Or(tokens, &pos, expression);
+    if (pos != tokens.size()) {
+        throw std::invalid_argument("Trigger_Menu: unexpected " + tokens.at(pos) + " in " + expression);
+    }
+
+    Trigger_Expression compiled;
+    for (auto &term : terms) {
+        auto nbits = 0;
+        for (auto mask : term) {
+            nbits += __builtin_popcountll(mask);
+        }
+        if (nbits == 1) {
+            for (unsigned word = 0; word < term.size(); word++) {
+                compiled.any[word] |= term[word];
+            }
+        } else {
+            compiled.all.push_back(term);
+        }
+    }
+    return compiled;
+}
+
+// Compile_Pattern resolves the paths and builds the byte tables of a
+// Trigger_Pattern. Path i sets bit i of the pattern. Throws for an
+// unknown path or more than 32 paths.
+Trigger_Pattern Trigger_Menu::Compile_Pattern(const std::vector<std::string> &names) const {
+    if (names.size() > 32) {
+        throw std::invalid_argument("Trigger_Menu: a pattern can't hold more than 32 paths");
+    }
+    Trigger_Pattern pattern;
+    for (unsigned path = 0; path < names.size(); path++) {
+        auto trigger = Resolve(names.at(path));
+        auto shift = trigger.bit / 8 * 8;
+        auto table = std::find_if(pattern.tables.begin(), pattern.tables.end(), [&](const Trigger_Pattern::Byte_Table &other) {
+            return other.word == trigger.word && other.shift == shift;
+        });
+        if (table == pattern.tables.end()) {
+            Trigger_Pattern::Byte_Table empty;
+            empty.word = trigger.word;
+            empty.shift = shift;
+            empty.patterns.fill(0);
+            pattern.tables.push_back(empty);
+            table = pattern.tables.end() - 1;
+        }
+        for (unsigned value = 0; value < 256; value++) {
+            if (value >> (trigger.bit - shift) & 1) {
+                table->patterns[value] |= 1u << path;
+            }
+        }
+    }
+    return pattern;
+}
+
+// Parse_Or parses terms joined by ||. The result holds the terms of
+// all operands.
+Trigger_Menu::Terms Trigger_Menu::Parse_Or(const std::vector<std::string> &tokens, unsigned *pos, const std::string &expression) const {
+    auto terms = Parse_And(tokens, pos, expression);
+    while (*pos < tokens.size() && tokens.at(*pos) == "||") {
+        (*pos)++;
+        auto more = Parse_And(tokens, pos, expression);
+        terms.insert(terms.end(), more.begin(), more.end());
+    }
+    return terms;
+}
+
+// Parse_And parses operands joined by &&. The result holds one term
+// for every combination of the terms of the operands.
+Trigger_Menu::Terms Trigger_Menu::Parse_And(const std::vector<std::string> &tokens, unsigned *pos, const std::string &expression) const {
+    auto terms = Parse_Path(tokens, pos, expression);
+    while (*pos < tokens.size() && tokens.at(*pos) == "&&") {
+        (*pos)++;
+        auto other = Parse_Path(tokens, pos, expression);
+        Terms combined;
+        for (auto &left : terms) {
+            for (auto &right : other) {
+                combined.push_back(Trigger_Masks{{left[0] | right[0], left[1] | right[1], left[2] | right[2]}});
+            }
+        }
+        terms = combined;
+    }
+    return terms;
+}
+
+// Parse_Path parses a single path or an expression in parentheses.
+Trigger_Menu::Terms Trigger_Menu::Parse_Path(const std::vector<std::string> &tokens, unsigned *pos, const std::string &expression) const {
+    if (*pos >= tokens.size()) {
+        throw std::invalid_argument("Trigger_Menu: unexpected end of " + expression);
+    }
+    auto token = tokens.at((*pos)++);
+    if (token == "(") {
+        auto terms = Parse_Or(tokens, pos, expression);
+        if (*pos >= tokens.size() || tokens.at(*pos) != ")") {
+            throw std::invalid_argument("Trigger_Menu: missing ) in " + expression);
+        }
+        (*pos)++;
+        return terms;
+    } else if (token == ")" || token == "||" || token == "&&") {
+        throw std::invalid_argument("Trigger_Menu: unexpected " + token + " in " + expression);
+    }
+    auto trigger = Resolve(token);
+    Trigger_Masks masks = {{0, 0, 0}};
+    masks[trigger.word] = 1ULL << trigger.bit;
+    return Terms(1, masks);
+}
+
+// triggered_ranges returns the entries of the chain made from files
+// passing the expression, as sorted [first, last) ranges. Only the three
+// trigger words are read. The ranges of every file are cached in
+// cache_dir, so later jobs with the same triggers don't read any
+// entry that fails them. entries holds the number of entries of every
+// file (see entries_per_file).
+std::vector<Entry_Range> triggered_ranges(const Trigger_Expression &expression, const std::vector<std::string> &files,
+                                          const std::vector<Long64_t> &entries, const std::string &tree_name, const std::string &cache_dir) {
+    std::vector<Entry_Range> ranges;
+    Long64_t offset(0);
+    for (unsigned i = 0; i < files.size(); i++) {
+        auto key = "triggers " + expression.getKey() + " " + files.at(i) + " " + tree_name + " entries " + std::to_string(entries.at(i));
+        auto base = files.at(i).substr(files.at(i).rfind("/") + 1, std::string::npos);
+        std::stringstream cache_name;
+        cache_name << cache_dir << "/" << base.substr(0, base.rfind(".root")) << "_triggers_" << std::hex << std::hash<std::string>()(key) << ".txt";
+
+        // read the ranges of the file from the cache
+        std::vector<Entry_Range> file_ranges;
+        std::ifstream fin(cache_name.str());
+        std::string line;
+        auto cached = std::getline(fin, line) && line == key;
+        if (cached) {
+            size_t nranges(0);
+            fin >> nranges;
+            file_ranges.resize(nranges);
+            for (auto &range : file_ranges) {
+                fin >> range.first >> range.second;
+            }
+            cached = !fin.fail();
+        }
+
+        // or scan the trigger words of every entry
+        if (!cached) {
+            file_ranges.clear();
+            auto chain = build_chain({files.at(i)}, tree_name, {entries.at(i)});
+            disable_all_branches(chain.get());
+            Branch_Registry registry(chain.get());
+            Trigger_Masks words = {{0, 0, 0}};
+            for (unsigned word = 0; word < trigger_word_names.size(); word++) {
+                registry.Bind(trigger_word_names.at(word), &words[word]);
+            }
+            for (Long64_t entry = 0; entry < entries.at(i); entry++) {
+                registry.Load(chain->LoadTree(entry));
+                if (!expression.Pass(words)) {
+                    continue;
+                }
+                if (!file_ranges.empty() && file_ranges.back().second == entry) {
+                    file_ranges.back().second = entry + 1;
+                } else {
+                    file_ranges.push_back(std::make_pair(entry, entry + 1));
+                }
+            }
+            auto temp_name = temp_file_name(cache_name.str());
+            std::ofstream fout(temp_name, std::ios::out | std::ios::trunc);
+            fout << key << std::endl;
+            fout << file_ranges.size() << std::endl;
+            for (auto &range : file_ranges) {
+                fout << range.first << " " << range.second << std::endl;
+            }
+            replace_file(&fout, temp_name, cache_name.str());
+        }
+
+        for (auto &range : file_ranges) {
+            ranges.push_back(std::make_pair(offset + range.first, offset + range.second));
+        }
+        offset += entries.at(i);
+    }
+    return ranges;
+}
+
+#endif  // INTERFACE_TRIGGERS_H_
@@ -3,10 +3,12 @@
 #ifndef INTERFACE_UTIL_H_
 #define INTERFACE_UTIL_H_
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 #include <string>
 #include <vector>
+#include "./p4.h"
 
 // enum for things like ID working points
 enum working_point {
@@ -17,6 +19,18 @@ enum working_point {
     vtight
 };
 
+// bit positions of the tau IDs packed into a single word. The
+// isolation and electron rejection bits are offset by the
+// working_point, e.g. medium isolation is bit iso_bit + medium.
+enum tau_id_bit {
+    iso_bit = 0,
+    ele_rejection_bit = 5,
+    loose_mu_rejection_bit = 10,
+    tight_mu_rejection_bit = 11,
+    dm_finding_bit = 12,
+    new_dm_finding_bit = 13
+};
+
 // luminosity for each year
 std::map<std::string, double> lumi = {
   {"2016", 35900},
@@ -82,9 +96,23 @@ std::map<std::string, double> cross_sections = {
   {"Data", 1.}
 };
 
-// calculate the tranverse mass
-double transverse_mass(std::vector<double> p1, std::vector<double> p2) {
-  return sqrt(pow(p1.at(0) + p2.at(0), 2) - pow(p1.at(1) + p2.at(1), 2) - pow(p1.at(2) + p2.at(2), 2));
+// cross_section returns the cross section of the named sample
+// or 0 if the sample is unknown. Unlike cross_sections[name], it
+// never modifies the map, so it is safe to call from multiple threads.
+double cross_section(const std::string &sample) {
+  auto xs = cross_sections.find(sample);
+  if (xs == cross_sections.end()) {
+    return 0.;
+  }
+  return xs->second;
+}
+
+// calculate the tranverse mass of two objects (e.g. a lepton and MET)
+double transverse_mass(const PtEtaPhiM &p1, const PtEtaPhiM &p2) {
+  auto et = p1.Et() + p2.Et();
+  auto px = p1.Px() + p2.Px();
+  auto py = p1.Py() + p2.Py();
+  return sqrt(std::max(et * et - px * px - py * py, 0.));
 }
 
 #endif  // INTERFACE_UTIL_H_
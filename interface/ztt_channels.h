@@ -0,0 +1,500 @@
+// Copyright [2019] Tyler Mitchell
+
+#ifndef INTERFACE_ZTT_CHANNELS_H_
+#define INTERFACE_ZTT_CHANNELS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./analyzer.h"
+#include "./event_view.h"
+#include "./hist_buffer.h"
+#include "./histManager.h"
+#include "./pairing.h"
+#include "./selection.h"
+#include "./triggers.h"
+
+// The channels of the Z->tautau scale factor measurement are
+// analyzers (see analyzer.h) registered as "mt", "et" and "mm", so
+// the analyzer host can run any of them over the same input. The
+// triggers are resolved by name from the trigger_menu in Begin.
+
+// Ztt_Hist_Ids holds the handles of all histograms filled by a
+// channel. They are looked up in Begin, so a histogram missing from
+// the json config stops the job before any event is processed.
+struct Ztt_Hist_Ids {
+    Ztt_Hist_Ids() : cutflow{0} {}
+    explicit Ztt_Hist_Ids(const histManager &hists)
+        : cutflow(hists.Get1D("cutflow")),
+          regions(hists.GetRegions({"charge", "iso", "tau_id"}, {"Z_mass", "Z_pt"})),
+          pileup_up(hists.GetRegions({"charge", "iso", "tau_id"}, {"Z_mass", "Z_pt"}, "pileup_up")),
+          pileup_down(hists.GetRegions({"charge", "iso", "tau_id"}, {"Z_mass", "Z_pt"}, "pileup_down")) {}
+    Hist_1D cutflow;
+    Region_Hists regions;                 // Z_mass and Z_pt in every region
+    Region_Hists pileup_up, pileup_down;  // the same with the shifted pileup weights
+};
+
+// ztt_preselection is the part of the selection shared by all
+// channels: b-jet veto and HT > 200 GeV. It returns the number of cuts
+// passed (0 to 2), so each channel can fill its own cutflow.
+int ztt_preselection(Event_View *view, Selection<Jets> *jets) {
+    auto &jet_factory = view->getJets();
+    if (jet_factory.getNBTags() > 0) {  // b-jet veto
+        return 0;
+    }
+
+    // get good jets and HT
+    jets->Reset(jet_factory.getJets());
+    for (unsigned i = 0; i < jet_factory.getJets().size(); i++) {
+        auto jet = jet_factory.getJets().at(i);
+        // jets are sorted by pT so once we find one with pT < 30
+        // there's no point in looping through the rest
+        if (jet.getPt() < 30) {
+            break;
+        }
+
+        // apply eta selection
+        if (fabs(jet.getEta()) < 2.4) {
+            jets->Add(i);
+        }
+    }
+    return jet_factory.HT(*jets) > 200 ? 2 : 1;
+}
+
+// pass_electron_veto returns false if the event has any
+// loose electrons. This is used to veto extra electrons in the
+// event.
+bool pass_electron_veto(const VElectron &all_electrons) {
+    for (auto &el : all_electrons) {
+        if (el.getPt() > 10 && fabs(el.getEta()) < 2.4) {
+            return false;  // veto any electrons in the event
+        }
+    }
+    return true;
+}
+
+// pass_muon_veto returns false if the event has any
+// loose muons. This is used to veto extra muons in the
+// event.
+bool pass_muon_veto(const VMuon &all_muons) {
+    for (auto &mu : all_muons) {
+        if (mu.getPt() > 10 && fabs(mu.getEta()) < 2.5) {
+            return false;  // veto any muons in the event
+        }
+    }
+    return true;
+}
+
+// calculate_muon_iso returns true if the muon
+// passes the isolation requirements and false otherwise.
+bool calculate_muon_iso(const Muon &mu) {
+    auto iso = mu.getPFChIso() / mu.getPt();
+    iso += std::max(0., mu.getPFNeuIso() + mu.getPFPhoIso() - 0.5 * mu.getPFPUIso()) / mu.getPt();
+    return iso < 0.2;
+}
+
+// calculate_electron_iso returns true if the electron
+// passes the isolation requirements and false otherwise.
+bool calculate_electron_iso(const Electron &el) {
+    if (fabs(el.getSCEta()) < 0.8 && el.getIDMVAIso() > 0.941) {
+        return true;
+    } else if (fabs(el.getSCEta()) > 0.8 && fabs(el.getSCEta()) < 1.5 && el.getIDMVAIso() > 0.899) {
+        return true;
+    } else if (fabs(el.getSCEta()) > 1.5 && el.getIDMVAIso() > 0.758) {
+        return true;
+    }
+    return false;
+}
+
+// Mt_Channel selects boosted Z->tautau->mu+tau_h events.
+class Mt_Channel : public Analyzer {
+   public:
+    Mt_Channel() { mu_tau_pairs.DeltaR_Window(0.4, 0.8).Rank(highest_pt); }
+    void Begin(const histManager &hists) {
+        ids = Ztt_Hist_Ids(hists);
+        trigger = trigger_menu().Compile("HLT_IsoMu24_v");
+    }
+    void Process(Event_View *, Hist_Buffer *);
+
+   private:
+    void Select_Muons(const VMuon &);
+    void Select_Taus(const VBoosted &);
+
+    Ztt_Hist_Ids ids;
+    Trigger_Expression trigger;
+
+    // objects passing the analysis selection. These are kept
+    // between events so no memory is allocated per event.
+    Selection<Jets> jets;
+    Selection<Muon> muons;
+    Selection<Boosted> taus;
+    Pair_Finder mu_tau_pairs;  // mu/tau pairs with 0.4 < DeltaR < 0.8
+};
+
+// Process runs the mu+tau_h selection on the current event.
+void Mt_Channel::Process(Event_View *view, Hist_Buffer *hists) {
+    auto evtwt = view->getWeight();
+
+    /////////////////////////
+    // Begin pre-selection //
+    /////////////////////////
+    if (trigger.Pass(view->getEvent())) {
+        hists->Fill(ids.cutflow, 1., evtwt);
+    } else {
+        return;
+    }
+
+    auto passed = ztt_preselection(view, &jets);
+    for (auto cut = 1; cut <= passed; cut++) {  // b-jet veto and HT
+        hists->Fill(ids.cutflow, 1. + cut, evtwt);
+    }
+    if (passed < 2) {
+        return;
+    }
+
+    if (pass_electron_veto(view->getElectrons().getElectrons())) {  // no electrons in the event
+        hists->Fill(ids.cutflow, 4., evtwt);
+    } else {
+        return;
+    }
+
+    // get leptons
+    Select_Muons(view->getMuons().getMuons());
+    Select_Taus(view->getTaus().getTaus());
+
+    ///////////////////////////////////
+    // Begin signal region selection //
+    ///////////////////////////////////
+
+    // veto on too many muons
+    if (muons.size() < 2) {
+        hists->Fill(ids.cutflow, 5., evtwt);
+    } else {
+        return;
+    }
+
+    // check if we find a good tau
+    if (taus.size() > 0) {
+        hists->Fill(ids.cutflow, 7., evtwt);
+    } else {
+        return;
+    }
+
+    // check if we found a good passing or failing muon
+    if (muons.size() > 0) {
+        hists->Fill(ids.cutflow, 8., evtwt);
+    } else {
+        return;
+    }
+
+    // use the pair with the highest scalar pT sum
+    auto &pairs = mu_tau_pairs.Find(muons, taus);
+    if (pairs.size() > 0) {
+        hists->Fill(ids.cutflow, 9., evtwt);
+    } else {
+        return;
+    }
+    auto good_muon = muons.at(pairs.front().first);
+    auto good_tau = taus.at(pairs.front().second);
+
+    auto pass_muon_isolation = calculate_muon_iso(good_muon);
+    auto mu_vector(good_muon.getP4());
+    auto tau_vector(good_tau.getP4());
+
+    hists->Fill(ids.cutflow, 10., evtwt);
+    auto pass_tau_id = good_tau.getIso(medium);
+    if (pass_tau_id) {
+        hists->Fill(ids.cutflow, 11., evtwt);
+    } else if (!good_tau.getIso(vloose)) {
+        return;
+    }
+
+    // bit 0: same-sign, bit 1: anti-isolated muon, bit 2: tau fails ID
+    unsigned region = (good_muon.getCharge() * good_tau.getCharge() >= 0) | !pass_muon_isolation << 1 | !pass_tau_id << 2;
+    auto Z = mu_vector + tau_vector;
+    hists->Fill(ids.regions, region, {Z.M(), Z.Pt()}, evtwt);
+    hists->Fill(ids.pileup_up, region, {Z.M(), Z.Pt()}, view->getNormalization() * view->getPileup().up);
+    hists->Fill(ids.pileup_down, region, {Z.M(), Z.Pt()}, view->getNormalization() * view->getPileup().down);
+}
+
+// Select_Muons selects all muons passing the muon
+// selection.
+void Mt_Channel::Select_Muons(const VMuon &all_muons) {
+    muons.Reset(all_muons);
+    for (unsigned i = 0; i < all_muons.size(); i++) {
+        auto mu = all_muons.at(i);
+        if (mu.getPt() > 60 && fabs(mu.getEta()) < 2.4 && mu.getID(medium)
+            && fabs(mu.getD0()) < 0.045 && fabs(mu.getDz()) < 0.2) {
+            muons.Add(i);
+        }
+    }
+}
+
+// Select_Taus selects all taus passing the tau
+// selection.
+void Mt_Channel::Select_Taus(const VBoosted &all_taus) {
+    taus.Reset(all_taus);
+    for (unsigned i = 0; i < all_taus.size(); i++) {
+        if (all_taus.at(i).getPt() > 20 && fabs(all_taus.at(i).getEta()) < 2.3 && all_taus.at(i).getMuRejection(tight) &&
+            all_taus.at(i).getEleRejection(vloose) && all_taus.at(i).getDiscByDM(false) > 0.5) {
+            taus.Add(i);
+        }
+    }
+}
+
+REGISTER_ANALYZER(Mt_Channel, "mt");
+
+// Et_Channel selects boosted Z->tautau->e+tau_h events.
+class Et_Channel : public Analyzer {
+   public:
+    Et_Channel() { el_tau_pairs.DeltaR_Window(0.4, 0.8).Rank(highest_pt); }
+    void Begin(const histManager &hists) {
+        ids = Ztt_Hist_Ids(hists);
+        trigger = trigger_menu().Compile("HLT_Ele35_WPTight_Gsf_v || HLT_Ele27_WPTight_Gsf_v");
+    }
+    void Process(Event_View *, Hist_Buffer *);
+
+   private:
+    void Select_Electrons(const VElectron &);
+    void Select_Taus(const VBoosted &);
+
+    Ztt_Hist_Ids ids;
+    Trigger_Expression trigger;
+
+    // objects passing the analysis selection. These are kept
+    // between events so no memory is allocated per event.
+    Selection<Jets> jets;
+    Selection<Electron> electrons;
+    Selection<Boosted> taus;
+    Pair_Finder el_tau_pairs;  // e/tau pairs with 0.4 < DeltaR < 0.8
+};
+
+// Process runs the e+tau_h selection on the current event.
+void Et_Channel::Process(Event_View *view, Hist_Buffer *hists) {
+    auto evtwt = view->getWeight();
+
+    /////////////////////////
+    // Begin pre-selection //
+    /////////////////////////
+    if (trigger.Pass(view->getEvent())) {
+        hists->Fill(ids.cutflow, 1., evtwt);
+    } else {
+        return;
+    }
+
+    auto passed = ztt_preselection(view, &jets);
+    for (auto cut = 1; cut <= passed; cut++) {  // b-jet veto and HT
+        hists->Fill(ids.cutflow, 1. + cut, evtwt);
+    }
+    if (passed < 2) {
+        return;
+    }
+
+    if (pass_muon_veto(view->getMuons().getMuons())) {  // no muons in the event
+        hists->Fill(ids.cutflow, 4., evtwt);
+    } else {
+        return;
+    }
+
+    // get leptons
+    Select_Electrons(view->getElectrons().getElectrons());
+    Select_Taus(view->getTaus().getTaus());
+
+    ///////////////////////////////////
+    // Begin signal region selection //
+    ///////////////////////////////////
+
+    // veto on too many electrons
+    if (electrons.size() < 2) {
+        hists->Fill(ids.cutflow, 5., evtwt);
+    } else {
+        return;
+    }
+
+    // check if we find a good tau
+    if (taus.size() > 0) {
+        hists->Fill(ids.cutflow, 7., evtwt);
+    } else {
+        return;
+    }
+
+    // check if we found a good passing or failing electrons
+    if (electrons.size() > 0) {
+        hists->Fill(ids.cutflow, 8., evtwt);
+    } else {
+        return;
+    }
+
+    // use the pair with the highest scalar pT sum
+    auto &pairs = el_tau_pairs.Find(electrons, taus);
+    if (pairs.size() > 0) {
+        hists->Fill(ids.cutflow, 9., evtwt);
+    } else {
+        return;
+    }
+    auto good_electron = electrons.at(pairs.front().first);
+    auto good_tau = taus.at(pairs.front().second);
+
+    auto pass_electron_isolation = calculate_electron_iso(good_electron);
+    auto el_vector(good_electron.getP4());
+    auto tau_vector(good_tau.getP4());
+
+    hists->Fill(ids.cutflow, 10., evtwt);
+    auto pass_tau_id = good_tau.getIso(medium);
+    if (pass_tau_id) {
+        hists->Fill(ids.cutflow, 11., evtwt);
+    } else if (!good_tau.getIso(vloose)) {
+        return;
+    }
+
+    // bit 0: same-sign, bit 1: anti-isolated electron, bit 2: tau fails ID
+    unsigned region = (good_electron.getCharge() * good_tau.getCharge() >= 0) | !pass_electron_isolation << 1 | !pass_tau_id << 2;
+    auto Z = el_vector + tau_vector;
+    hists->Fill(ids.regions, region, {Z.M(), Z.Pt()}, evtwt);
+    hists->Fill(ids.pileup_up, region, {Z.M(), Z.Pt()}, view->getNormalization() * view->getPileup().up);
+    hists->Fill(ids.pileup_down, region, {Z.M(), Z.Pt()}, view->getNormalization() * view->getPileup().down);
+}
+
+// Select_Electrons selects all electrons passing the electron
+// selection.
+void Et_Channel::Select_Electrons(const VElectron &all_electrons) {
+    electrons.Reset(all_electrons);
+    for (unsigned i = 0; i < all_electrons.size(); i++) {
+        auto el = all_electrons.at(i);
+        if (el.getPt() > 40 && fabs(el.getEta()) < 2.5) {
+            electrons.Add(i);
+        }
+    }
+}
+
+// Select_Taus selects all taus passing the tau
+// selection.
+void Et_Channel::Select_Taus(const VBoosted &all_taus) {
+    taus.Reset(all_taus);
+    for (unsigned i = 0; i < all_taus.size(); i++) {
+        if (all_taus.at(i).getPt() > 20 && fabs(all_taus.at(i).getEta()) < 2.3 && all_taus.at(i).getMuRejection(loose) &&
+            all_taus.at(i).getEleRejection(tight) && all_taus.at(i).getDiscByDM(false) > 0.5) {
+            taus.Add(i);
+        }
+    }
+}
+
+REGISTER_ANALYZER(Et_Channel, "et");
+
+// Mm_Channel selects boosted Z->mumu events for the control region.
+class Mm_Channel : public Analyzer {
+   public:
+    void Begin(const histManager &hists) {
+        ids = Ztt_Hist_Ids(hists);
+        trigger = trigger_menu().Compile("HLT_IsoMu24_v");
+    }
+    void Process(Event_View *, Hist_Buffer *);
+
+   private:
+    void Select_Muons(const VMuon &);
+
+    Ztt_Hist_Ids ids;
+    Trigger_Expression trigger;
+
+    // objects passing the analysis selection. These are kept
+    // between events so no memory is allocated per event.
+    Selection<Jets> jets;
+    Selection<Muon> muons;
+};
+
+// Process runs the mu+mu selection on the current event.
+void Mm_Channel::Process(Event_View *view, Hist_Buffer *hists) {
+    auto evtwt = view->getWeight();
+
+    /////////////////////////
+    // Begin pre-selection //
+    /////////////////////////
+    if (trigger.Pass(view->getEvent())) {
+        hists->Fill(ids.cutflow, 1., evtwt);
+    } else {
+        return;
+    }
+
+    auto passed = ztt_preselection(view, &jets);
+    for (auto cut = 1; cut <= passed; cut++) {  // b-jet veto and HT
+        hists->Fill(ids.cutflow, 1. + cut, evtwt);
+    }
+    if (passed < 2) {
+        return;
+    }
+
+    if (pass_electron_veto(view->getElectrons().getElectrons())) {  // no electrons in the event
+        hists->Fill(ids.cutflow, 4., evtwt);
+    } else {
+        return;
+    }
+
+    // get leptons
+    Select_Muons(view->getMuons().getMuons());
+
+    //////////////////////////////
+    // Begin Zmumu CR selection //
+    //////////////////////////////
+
+    // only dimuon events
+    if (muons.size() == 2) {
+        hists->Fill(ids.cutflow, 5., evtwt);
+    } else {
+        return;
+    }
+
+    // lead muon needs to be harder
+    if (muons.at(0).getPt() > 30) {
+        hists->Fill(ids.cutflow, 6., evtwt);
+    } else {
+        return;
+    }
+
+    // get our dimuon pair
+    auto lead_muon = muons.at(0);
+    auto sub_muon = muons.at(1);
+
+    // make sure they are near each other (somewhat boosted)
+    if (lead_muon.getP4().DeltaR(sub_muon.getP4()) < 1.) {
+        hists->Fill(ids.cutflow, 7., evtwt);
+    } else {
+        return;
+    }
+
+    // reconstruct Z and make sure it has sufficient pT
+    auto recoZ = (lead_muon.getP4() + sub_muon.getP4());
+    if (recoZ.Pt() > 40) {
+        hists->Fill(ids.cutflow, 8., evtwt);
+    } else {
+        return;
+    }
+
+    // fill control histograms. Only the charge axis is used, so
+    // the events end up in OS_pass or SS_pass.
+    unsigned region = (lead_muon.getCharge() * sub_muon.getCharge() >= 0);
+    hists->Fill(ids.regions, region, {recoZ.M(), recoZ.Pt()}, evtwt);
+    hists->Fill(ids.pileup_up, region, {recoZ.M(), recoZ.Pt()}, view->getNormalization() * view->getPileup().up);
+    hists->Fill(ids.pileup_down, region, {recoZ.M(), recoZ.Pt()}, view->getNormalization() * view->getPileup().down);
+}
+
+// Select_Muons selects all isolated muons passing the muon
+// selection.
+void Mm_Channel::Select_Muons(const VMuon &all_muons) {
+    muons.Reset(all_muons);
+    for (unsigned i = 0; i < all_muons.size(); i++) {
+        auto mu = all_muons.at(i);
+        if (mu.getPt() > 10 && fabs(mu.getEta()) < 2.4 && mu.getID(medium)
+            && fabs(mu.getD0()) < 0.045 && fabs(mu.getDz()) < 0.2) {
+            if (calculate_muon_iso(mu) < 0.2) {
+                muons.Add(i);
+            }
+        }
+    }
+}
+
+REGISTER_ANALYZER(Mm_Channel, "mm");
+
+#endif  // INTERFACE_ZTT_CHANNELS_H_
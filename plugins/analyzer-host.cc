@@ -0,0 +1,446 @@
+// Copyright [2019] Tyler Mitchell
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "TROOT.h"
+#include "TTree.h"
+
+// utilities
+#include "../interface/CLParser.h"
+#include "../interface/analyzer.h"
+#include "../interface/branch_registry.h"
+#include "../interface/column_cache.h"
+#include "../interface/duplicates.h"
+#include "../interface/event_loop.h"
+#include "../interface/histManager.h"
+#include "../interface/input_files.h"
+#include "../interface/json.hpp"
+#include "../interface/lumi_mask.h"
+#include "../interface/pileup.h"
+#include "../interface/skim.h"
+#include "../interface/triggers.h"
+
+// Objects
+#include "../interface/event_view.h"
+#include "../interface/util.h"
+
+// Analyzers. Including the header registers them with the host.
+#include "../interface/trigger_study.h"
+#include "../interface/ztt_channels.h"
+
+using std::string;
+using std::vector;
+
+// Analyzer_Config is one analyzer run by the host and the json
+// config of its histograms.
+struct Analyzer_Config {
+    std::string name, histograms;
+};
+
+std::vector<Analyzer_Config> read_analyzer_config(const std::string&, const std::string&);
+
+// analyzer-host runs any number of registered analyzers (see
+// interface/analyzer.h) in a single pass over the input. The factories
+// are run at most once per event through a shared Event_View and every
+// analyzer writes its histograms to its own output file. Analyzers are
+// picked with -a (repeatable) or listed in a json file given with -c.
+// With --skim, the events passing the skim selection are copied to a
+// slimmed ggNtuple. Analyzers then only run if -a or -c is given.
+// With --write-cache, the output of all factories is stored in a column
+// cache which later jobs over the same input read with --read-cache
+// instead of the ggNtuples. With --lumi-mask, only the entries of
+// certified lumi sections are read and --remove-duplicates skips events
+// stored more than once (e.g. in SingleMuon and SingleElectron).
+// --trigger only processes events firing a trigger expression and
+// --trigger-scan lists those events once so later jobs skip the rest.
+int main(int argc, char** argv) {
+    auto parser = std::unique_ptr<CLParser>(new CLParser(argc, argv));
+    auto verbose = parser->Flag("-v");
+    auto is_data = parser->Flag("--data");
+    auto input_names = parser->RepeatedOption("-i");
+    auto output_name = parser->Option("-o");
+    auto tree_name = parser->Option("-t", "ggNtuplizer/EventTree");
+    auto histograms = parser->Option("-j", "configs/ztt-sf-measurement.json");
+    auto analyzer_names = parser->RepeatedOption("-a");  // analyzers to run
+    auto analyzer_config = parser->Option("-c");          // json file listing the analyzers to run
+    auto nthreads = std::stoi(parser->Option("--threads", "1"));
+    if (nthreads < 1) {
+        throw std::invalid_argument("analyzer-host: --threads needs at least 1 thread");
+    }
+    if (nthreads > 1) {
+        ROOT::EnableThreadSafety();  // before any file is opened
+    }
+    auto first = std::stoll(parser->Option("--first", "0"));
+    auto last = std::stoll(parser->Option("--last", "-1"));
+    auto nchunks = std::stoi(parser->Option("--chunks", "1"));
+    auto ichunk = std::stoi(parser->Option("--chunk", "0"));
+    auto fill_buffer = std::stoi(parser->Option("--fill-buffer", "0"));  // fills kept per histogram before binning
+    auto pu_files = parser->MultiOption("--pileup", 3);                   // nominal, up and down data pileup profiles
+    auto pu_cache = parser->Option("--pileup-cache", "Output");          // directory for the cached pileup tables
+    auto skim_config = parser->Option("--skim");                          // json file with the skim selection
+    Skim_Settings skim_settings{std::stoi(parser->Option("--skim-compression", "404")),  // LZ4, level 4
+                                std::stoi(parser->Option("--skim-basket", "64000")),
+                                std::stoll(parser->Option("--skim-flush", "30000000"))};
+    auto write_cache = parser->Option("--write-cache");  // directory to store the factory outputs in
+    auto read_cache = parser->Option("--read-cache");    // directory to read the factory outputs from
+    auto lumi_json = parser->Option("--lumi-mask");       // golden json with the certified lumi sections
+    auto lumi_cache = parser->Option("--lumi-cache", "Output");  // directory for the lumi index of every file
+    auto remove_duplicates = parser->Flag("--remove-duplicates");
+    auto menu_name = parser->Option("--trigger-menu", "configs/triggers.json");  // names and bits of the HLT paths
+    auto trigger_expression = parser->Option("--trigger");                       // e.g. "HLT_IsoMu24_v || HLT_Ele35_WPTight_Gsf_v"
+    auto trigger_scan = parser->Flag("--trigger-scan");
+    if (parser->Flag("--list")) {
+        for (auto& name : analyzer_registry().getNames()) {
+            std::cout << name << std::endl;
+        }
+        return 0;
+    }
+
+    trigger_menu().Read(menu_name);  // before any analyzer is created
+
+    // without -a or -c, every registered analyzer is run
+    std::vector<Analyzer_Config> configs;
+    if (!analyzer_config.empty()) {
+        configs = read_analyzer_config(analyzer_config, histograms);
+    }
+    if (analyzer_config.empty() && analyzer_names.empty() && skim_config.empty()) {
+        analyzer_names = analyzer_registry().getNames();
+    }
+    for (auto& name : analyzer_names) {
+        configs.push_back(Analyzer_Config{name, analyzer_registry().getHistograms(name, histograms)});
+    }
+
+    // -i can be given multiple times and accepts globs and file lists
+    auto files = expand_inputs(input_names);
+
+    // create the log file
+    std::ofstream logfile;
+    auto output_base = output_name.substr(0, output_name.rfind(".root"));
+    logfile.open(output_base + ".log", std::ios::out | std::ios::trunc);
+    for (auto& file : files) {
+        logfile << "Processing file: " << file << std::endl;
+    }
+    logfile << "Using options:" << std::endl;
+    logfile << "\t is_data:     " << is_data << std::endl;
+    logfile << "\t output_name: " << output_name << std::endl;
+    logfile << "\t tree_name:   " << tree_name << std::endl;
+    logfile << "\t threads:     " << nthreads << std::endl;
+    for (auto& config : configs) {
+        logfile << "\t analyzer:    " << config.name << " (" << config.histograms << ")" << std::endl;
+    }
+    for (auto& pu_file : pu_files) {
+        logfile << "\t pileup:      " << pu_file << std::endl;
+    }
+    if (!skim_config.empty()) {
+        logfile << "\t skim:        " << skim_config << " (compression " << skim_settings.compression << ")" << std::endl;
+    }
+    if (!write_cache.empty() || !read_cache.empty()) {
+        logfile << "\t cache:       " << (write_cache.empty() ? "read from " + read_cache : "write to " + write_cache) << std::endl;
+    }
+    if (!lumi_json.empty()) {
+        logfile << "\t lumi mask:   " << lumi_json << std::endl;
+    }
+    logfile << "\t duplicates:  " << (remove_duplicates ? "removed" : "kept") << std::endl;
+    if (!trigger_expression.empty()) {
+        logfile << "\t trigger:     " << trigger_expression << (trigger_scan ? " (scanned)" : "") << std::endl;
+    }
+
+    // a skim copies the ggNtuple branches, which aren't in the cache
+    if (!read_cache.empty() && (!skim_config.empty() || !write_cache.empty())) {
+        throw std::invalid_argument("analyzer-host: --read-cache can't be combined with --skim or --write-cache");
+    }
+    // a cache holds every entry of a range. Entries can be skipped when reading it.
+    auto select_entries = !lumi_json.empty() || remove_duplicates || trigger_scan;
+    if ((!lumi_json.empty() || remove_duplicates) && !is_data) {
+        throw std::invalid_argument("analyzer-host: --lumi-mask and --remove-duplicates need --data");
+    }
+    if ((select_entries || !trigger_expression.empty()) && !write_cache.empty()) {
+        throw std::invalid_argument("analyzer-host: --write-cache stores every entry and can't skip any");
+    }
+    if (trigger_scan && trigger_expression.empty()) {
+        throw std::invalid_argument("analyzer-host: --trigger-scan needs --trigger");
+    }
+    Trigger_Expression trigger;
+    if (!trigger_expression.empty()) {
+        trigger = trigger_menu().Compile(trigger_expression);
+    }
+
+    // the skim selection is read once here, so a broken config stops
+    // the job before reading any event
+    nlohmann::json skim_cuts;
+    if (!skim_config.empty()) {
+        std::ifstream skim_file(skim_config);
+        if (!skim_file.good()) {
+            throw std::invalid_argument("analyzer-host: unable to open " + skim_config);
+        }
+        skim_file >> skim_cuts;
+        Mt_Skim_Selection check(skim_cuts);
+    }
+
+    // every analyzer writes to its own file, e.g. DYJets_output_mt.root.
+    // One instance of each analyzer is created here, so an unknown name or
+    // a histogram missing from the json config stops the job before reading
+    // any event. This instance also runs End once all threads are done.
+    std::vector<std::shared_ptr<histManager>> analyzer_hists;
+    std::vector<std::unique_ptr<Analyzer>> analyzers;
+    for (auto& config : configs) {
+        if (std::count_if(configs.begin(), configs.end(), [&](const Analyzer_Config& other) { return other.name == config.name; }) > 1) {
+            throw std::invalid_argument("analyzer-host: analyzer " + config.name + " is requested more than once");
+        }
+        auto hists = std::make_shared<histManager>(output_base + "_" + config.name + ".root");
+        hists->load_histograms(config.histograms);
+        hists->Set_Fill_Buffer(fill_buffer);
+        analyzers.push_back(analyzer_registry().Make(config.name));
+        analyzers.back()->Begin(*hists);
+        analyzer_hists.push_back(hists);
+    }
+
+    // read all input files through a single TChain
+    auto tree = build_chain(files, tree_name);
+    auto entries = entries_per_file(tree.get());
+
+    // every sample is normalized using the event count read from
+    // each file's hcount, summed over all files of the sample. A skim
+    // keeps the sum in its first part only, so the other parts, which
+    // have no hcount, add 0 events.
+    std::map<std::string, Double_t> sample_events;
+    std::shared_ptr<TH1F> hcount;
+    for (auto& file : files) {
+        auto fin = std::shared_ptr<TFile>(TFile::Open(file.c_str()));
+        auto nevt_hist = reinterpret_cast<TH1F*>(fin->Get("hcount"));
+        if (nevt_hist == nullptr) {
+            fin->Close();
+            continue;
+        }
+        sample_events[sample_name(file)] += nevt_hist->GetBinContent(2);
+        if (hcount == nullptr) {
+            hcount.reset(reinterpret_cast<TH1F*>(nevt_hist->Clone()));
+            hcount->SetDirectory(nullptr);
+        } else {
+            hcount->Add(nevt_hist);
+        }
+        fin->Close();
+    }
+
+    std::vector<Double_t> weights;
+    for (auto& file : files) {
+        auto sample = sample_name(file);
+        if (!is_data && sample_events[sample] <= 0) {
+            throw std::invalid_argument("analyzer-host: no hcount with events in any file of sample " + sample);
+        }
+        weights.push_back(is_data ? 1. : cross_section(sample) * lumi.at("2017") / sample_events.at(sample));
+    }
+
+    // pileup tables are built once per sample and cached in pu_cache.
+    // Without --pileup (and for data) every event gets a weight of 1.
+    std::vector<Pileup_Table> pileup(files.size());
+    if (!is_data && !pu_files.empty()) {
+        pileup = Pileup_Reweighting(pu_files).File_Tables(files, tree_name, pu_cache);
+    }
+
+    // a cache can only be read back for the same input
+    auto cache_key = tree_name;
+    for (auto& file : files) {
+        cache_key += " " + file;
+    }
+
+    // size of a full GetEntry, to compare with what we actually read
+    auto all_bytes = zip_bytes_per_event(tree.get(), false);
+
+    // only process the requested entries. With --chunks, the entries are
+    // split on cluster boundaries and only chunk --chunk is processed.
+    auto job = job_range(tree.get(), first, last, nchunks, ichunk);
+    auto nevts = job.second - job.first;
+    auto ranges = cluster_ranges(tree.get(), job.first, job.second, job_ranges);
+    Range_Queue queue(ranges);
+
+    // the header of every cache file is checked here, so a cache written
+    // for other input or ranges stops the job before reading any event
+    if (!read_cache.empty()) {
+        for (auto& range : ranges) {
+            Column_Cache_Reader check(cache_file_name(read_cache, range), cache_key, range);
+        }
+    }
+
+    // with a lumi mask, only the certified entries of every range are
+    // processed. The lumi blocks of every file are found once and cached
+    // in lumi_cache, so later jobs don't read the run and lumis branches.
+    // Duplicates are found for the whole input, not only this chunk, so
+    // every chunk keeps the same copy of an event. With --trigger-scan,
+    // the entries firing the trigger are also listed once and cached.
+    std::vector<Entry_Range> selected{job};
+    if (!lumi_json.empty()) {
+        selected = certified_ranges(Lumi_Mask(lumi_json), files, entries, tree_name, lumi_cache);
+    }
+    if (remove_duplicates) {
+        auto duplicates = Duplicate_Finder(files, entries, tree_name, lumi_cache).Find();
+        logfile << "Duplicate entries: " << duplicates.size() << " (all chunks)" << std::endl;
+        selected = remove_entries(selected, duplicates);
+    }
+    if (trigger_scan) {
+        selected = intersect_ranges(selected, triggered_ranges(trigger, files, entries, tree_name, lumi_cache));
+    }
+    if (select_entries) {
+        Long64_t nselected(0);
+        for (auto& piece : overlapping_ranges(selected, job)) {
+            nselected += piece.second - piece.first;
+        }
+        logfile << "Selected entries: " << nselected << " of " << nevts << std::endl;
+    }
+
+    // every range is filled into its own histograms for every analyzer.
+    // They are merged in the order of the ranges once all threads are
+    // done, so the output is identical for any number of threads.
+    std::vector<std::vector<Hist_Buffer>> range_hists;
+    for (auto& hists : analyzer_hists) {
+        range_hists.push_back(std::vector<Hist_Buffer>(ranges.size(), hists->Buffer()));
+    }
+    std::vector<Long64_t> thread_bytes(nthreads, 0);
+    std::vector<std::map<int, File_Stats>> thread_stats(nthreads);
+    std::vector<std::unique_ptr<Skim_Writer>> skims(nthreads);
+    std::mutex log_lock;
+    size_t nfinished(0);
+    run_threads(nthreads, [&](int ithread) {
+        // every thread needs its own TChain. The first thread uses the one
+        // that is already open.
+        auto thread_tree = tree;
+        if (ithread > 0) {
+            thread_tree = build_chain(files, tree_name, entries);
+        }
+        disable_all_branches(thread_tree.get());
+        Event_View view(thread_tree.get(), is_data, weights, pileup);
+
+        // every thread writes its own skim. The files are numbered like
+        // the parts of a sample (DYJets_1.root, ...), so they are read back
+        // as one sample.
+        std::unique_ptr<Mt_Skim_Selection> skim_selection;
+        if (!skim_config.empty()) {
+            auto skim_name = nthreads > 1 ? output_base + "_" + std::to_string(ithread) + ".root" : output_name;
+            skim_selection.reset(new Mt_Skim_Selection(skim_cuts));
+            skims.at(ithread).reset(new Skim_Writer(thread_tree.get(), skim_name, tree_name, skim_settings));
+        }
+        Column_Cache_Writer cache_writer(cache_key);
+        std::unique_ptr<Column_Cache_Reader> cache_reader;
+        std::vector<std::unique_ptr<Analyzer>> thread_analyzers;
+        for (unsigned ianalyzer = 0; ianalyzer < configs.size(); ianalyzer++) {
+            thread_analyzers.push_back(analyzer_registry().Make(configs.at(ianalyzer).name));
+            thread_analyzers.back()->Begin(*analyzer_hists.at(ianalyzer));
+        }
+
+        Entry_Range range;
+        size_t index;
+        while (queue.Next(&range, &index)) {
+            if (!read_cache.empty()) {
+                cache_reader.reset(new Column_Cache_Reader(cache_file_name(read_cache, range), cache_key, range));
+                view.Read_Cache(cache_reader.get());
+            }
+            cache_writer.Reset(range);
+            auto pieces = select_entries ? overlapping_ranges(selected, range) : std::vector<Entry_Range>{range};
+            for (auto& piece : pieces) {
+                for (auto i = piece.first; i < piece.second; i++) {
+                    view.Next(i);
+                    if (!trigger_expression.empty() && !trigger.Pass(view.getEvent())) {
+                        continue;
+                    }
+                    if (!write_cache.empty()) {
+                        view.Write_Cache(&cache_writer);
+                    }
+                    if (skim_selection != nullptr && skim_selection->Pass(&view)) {
+                        skims.at(ithread)->Fill(i);
+                    }
+                    for (unsigned ianalyzer = 0; ianalyzer < thread_analyzers.size(); ianalyzer++) {
+                        thread_analyzers[ianalyzer]->Process(&view, &range_hists[ianalyzer][index]);
+                    }
+                }
+            }
+            for (auto& buffers : range_hists) {
+                buffers.at(index).Flush();
+            }
+            if (!write_cache.empty()) {
+                cache_writer.Write(cache_file_name(write_cache, range));
+            }
+            view.Pause();
+
+            std::lock_guard<std::mutex> lock(log_lock);
+            nfinished++;
+            if (verbose) {
+                logfile << "\t" << 100 * nfinished / queue.size() << "% complete. (" << nevts << " total events)" << std::endl;
+            }
+        }
+        thread_bytes.at(ithread) = view.getBytesRead();
+        thread_stats.at(ithread) = view.getFileStats();
+    });
+
+    for (unsigned ianalyzer = 0; ianalyzer < analyzer_hists.size(); ianalyzer++) {
+        for (auto& buffer : range_hists.at(ianalyzer)) {
+            analyzer_hists.at(ianalyzer)->Merge(&buffer);
+        }
+        analyzers.at(ianalyzer)->End(analyzer_hists.at(ianalyzer).get());
+    }
+
+    Long64_t bytes_read(0);
+    std::map<int, File_Stats> file_stats;
+    for (auto i = 0; i < nthreads; i++) {
+        bytes_read += thread_bytes.at(i);
+        for (auto& stats : thread_stats.at(i)) {
+            file_stats[stats.first].entries += stats.second.entries;
+            file_stats[stats.first].seconds += stats.second.seconds;
+        }
+    }
+
+    logfile << "Processed entries " << job.first << " to " << job.second << std::endl;
+    logfile << "Throughput per file (summed over threads):" << std::endl;
+    for (auto& stats : file_stats) {
+        logfile << "\t " << files.at(stats.first) << ": " << stats.second.entries << " events in " << stats.second.seconds << " s ("
+                << stats.second.entries / std::max(stats.second.seconds, 1e-9) << " events/s)" << std::endl;
+    }
+    logfile << "Compressed bytes per event:" << std::endl;
+    logfile << "\t all branches:    " << all_bytes << std::endl;
+    logfile << "\t active branches: " << zip_bytes_per_event(tree.get(), true) << std::endl;
+    logfile << "Read " << (nevts > 0 ? bytes_read / nevts : 0) << " bytes per event (all analyzers together)" << std::endl;
+    for (auto& hists : analyzer_hists) {
+        hists->Write();
+    }
+
+    // the summed hcount is only stored once, by the first thread of the
+    // job starting at entry 0, so the skims of all threads, chunks and
+    // --first/--last jobs can be merged with hadd
+    for (unsigned ithread = 0; ithread < skims.size(); ithread++) {
+        if (skims.at(ithread) == nullptr) {
+            continue;
+        }
+        logfile << "Skimmed " << skims.at(ithread)->getEntries() << " events in thread " << ithread << std::endl;
+        if (ithread == 0 && job.first == 0 && hcount != nullptr) {
+            skims.at(ithread)->Write(hcount.get());
+        }
+        skims.at(ithread)->Close();
+    }
+    logfile.close();
+}
+
+// read_analyzer_config reads the list of analyzers from a json file
+//     {"analyzers": [{"name": "mt", "histograms": "configs/ztt-sf-measurement.json"}, {"name": "mm"}]}
+// Analyzers without "histograms" use the config they registered, or
+// else the default config given with -j.
+std::vector<Analyzer_Config> read_analyzer_config(const std::string& file_name, const std::string& default_histograms) {
+    std::ifstream config_file(file_name);
+    if (!config_file.good()) {
+        throw std::invalid_argument("analyzer-host: unable to open " + file_name);
+    }
+    nlohmann::json config;
+    config_file >> config;
+    std::vector<Analyzer_Config> configs;
+    for (auto& analyzer : config.at("analyzers")) {
+        std::string name = analyzer.at("name");
+        configs.push_back(Analyzer_Config{name, analyzer.value("histograms", analyzer_registry().getHistograms(name, default_histograms))});
+    }
+    return configs;
+}
@@ -3,16 +3,35 @@ import subprocess
 import multiprocessing
 
 
-def format_command(args, ifile):
+def sample_name(ifile):
+    # same as sample_name in interface/input_files.h: numbered files
+    # (sample_1.root, sample_2.root, ...) belong to the same sample
+    name = ifile.split('/')[-1].replace('.root', '')
+    if '_' in name and name.split('_')[-1].isdigit():
+      name = name[:name.rfind('_')]
+    return name
+
+
+def format_command(args, ifiles, ichunk=None):
     if not os.path.exists(args.output_dir):
       os.mkdir(args.output_dir)
+    ifile = ifiles[0]
     output_name = ifile.replace('.root', '_output.root').split('/')[-1]
+    if len(ifiles) > 1:
+      output_name = sample_name(ifile) + '_output.root'
+    if ichunk is not None:
+      output_name = output_name.replace('.root', '_chunk{}.root'.format(ichunk))
     print output_name
     if args.local:
       args.ext = ''
-    callstring = './{0} -i {1}{2} -o {3}/{4} -j {5} -t {6}'.format(args.exe, args.ext, ifile, args.output_dir, output_name, args.json, args.treename)
+    inputs = ' '.join(['-i {}{}'.format(args.ext, f) for f in ifiles])
+    callstring = './{0} {1} -o {2}/{3} -j {4} -t {5}'.format(args.exe, inputs, args.output_dir, output_name, args.json, args.treename)
     if args.verbose:
       callstring += ' -v'
+    if args.threads > 1:
+      callstring += ' --threads {}'.format(args.threads)
+    if ichunk is not None:
+      callstring += ' --chunks {} --chunk {}'.format(args.chunks, ichunk)
     if 'JetHT_Run' in ifile or 'muon' in ifile.lower() or 'electron' in ifile.lower() or 'data_output' in ifile.lower():
       callstring += ' --data'
     return callstring
@@ -24,15 +43,27 @@ def run_command(cmd):
 
 
 def main(args):
-    commands = []
     if args.local:
       file_list = [os.path.join(args.input_path, f) for f in os.listdir(args.input_path) if os.path.isfile(os.path.join(args.input_path, f))]
-      commands = [format_command(args, ifile) for ifile in file_list]
     else:
       search = ['xrdfs', 'root://cmseos.fnal.gov/', 'ls', args.input_path]
-      commands = [
-          format_command(args, ifile) for ifile in subprocess.check_output(search).split('\n') if '.root' in ifile
-      ]
+      file_list = [ifile for ifile in subprocess.check_output(search).split('\n') if '.root' in ifile]
+
+    # all files of a sample are read by a single process through a
+    # TChain. The host normalizes a sample with the hcount of the files
+    # it was given, so a process per numbered file would scale the
+    # merged output by the number of files.
+    samples = {}
+    for ifile in sorted(file_list):
+      samples.setdefault(sample_name(ifile), []).append(ifile)
+    jobs = [samples[name] for name in sorted(samples)]
+
+    # with chunks, every job is split on its cluster boundaries and
+    # each chunk is run as a separate job. Outputs can be merged with hadd.
+    if args.chunks > 1:
+      commands = [format_command(args, ifiles, ichunk) for ifiles in jobs for ichunk in range(args.chunks)]
+    else:
+      commands = [format_command(args, ifiles) for ifiles in jobs]
    
     if args.parallel:
       # Use 4 cores if the machine has more than 8 total cores.
@@ -65,5 +96,9 @@ if __name__ == "__main__":
                         default='configs/test.json', help='name of json config')
     parser.add_argument('--verbose', action='store_true', dest='verbose')
     parser.add_argument('--parallel', action='store_true', dest='parallel', help='run in multiprocess')
+    parser.add_argument('--threads', '-n', action='store', dest='threads', type=int,
+                        default=1, help='number of threads used by each process')
+    parser.add_argument('--chunks', '-c', action='store', dest='chunks', type=int,
+                        default=1, help='number of jobs each sample is split into')
 
     main(parser.parse_args())